@@ -1,15 +1,17 @@
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 
 #include "Acceptor.h"
 #include "Logger.h"
 #include "InetAddress.h"
 
-static int createNonblocking()
+static int createNonblocking(sa_family_t family)
 {
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd < 0)
     {
         LOG_FATAL("%s:%s:%d listen socket create err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
@@ -17,21 +19,64 @@ static int createNonblocking()
     return sockfd;
 }
 
-Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport)  //上层传入的loop
+// 指向同一个socket的新fd，各自注册到不同的epoll实例，各自关闭
+static int dupListenFd(int fd)
+{
+    int newfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (newfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d listen socket dup err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return newfd;
+}
+
+// 上次进程退出时留下的socket文件会让bind失败
+// 只删除连不上(ECONNREFUSED，没有进程在监听)的socket文件，普通文件和还在使用的socket保留，由bind报错
+static void removeStaleUnixSocket(const InetAddress &addr)
+{
+    std::string path = addr.unixPath();
+    struct stat st;
+    if (::lstat(path.c_str(), &st) < 0 || !S_ISSOCK(st.st_mode))
+    {
+        return;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0 && errno == ECONNREFUSED)
+    {
+        LOG_INFO("Acceptor - removing stale unix socket %s\n", path.c_str());
+        ::unlink(path.c_str());
+    }
+    ::close(fd);
+}
+
+Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport, bool ipv6Only)  //上层传入的loop
     : loop_(loop)
-    , acceptSocket_(createNonblocking())  // 将一个socket创建以后形成的fd，调用socket的构造函数，赋值给socket::sockfd_
+    , acceptSocket_(createNonblocking(listenAddr.family()))  // 将一个socket创建以后形成的fd，调用socket的构造函数，赋值给socket::sockfd_
     , acceptChannel_(loop, acceptSocket_.fd())  // channel类和文件描述符绑定在一起，同时给eventloop指针，对应主reactor的loop指针
     // acceptChannel_和socketfd进行绑定
     // 绑定给主reactor的原因是主reactor负责处理请求
     , listenning_(false)
+    , exclusive_(false)
 {
+    if (listenAddr.isUnixDomain() && !listenAddr.isAbstract())
+    {
+        removeStaleUnixSocket(listenAddr);
+    }
+    if (listenAddr.isIpv6())
+    {
+        // 显式设置，不依赖net.ipv6.bindv6only的系统默认值
+        acceptSocket_.setIpv6Only(ipv6Only);
+    }
     acceptSocket_.setReuseAddr(true);
     acceptSocket_.setReusePort(true);
     acceptSocket_.bindAddress(listenAddr);
     // TcpServer::start() => Acceptor.listen() 如果有新用户连接 要执行一个回调(accept => connfd => 打包成Channel => 唤醒subloop)
     // baseloop监听到有事件发生 => acceptChannel_(listenfd) => 执行该回调函数
-    acceptChannel_.setReadCallback(   // 绑定读回调
-        std::bind(&Acceptor::handleRead, this));  // 当有连接请求的时候，就会调用handleRead
+    acceptChannel_.setEventHandler(this);  // 当有连接请求的时候，就会调用handleRead
     /**
      * 对于channel绑定的回调函数，eventloop检测到后，会触发相应函数
      * for (Channel *channel : activeChannels_)
@@ -43,6 +88,16 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
 
 }
 
+Acceptor::Acceptor(EventLoop *loop, const Acceptor &shared)
+    : loop_(loop)
+    , acceptSocket_(dupListenFd(shared.acceptSocket_.fd()))   // shared已经bind，这里不再bind
+    , acceptChannel_(loop, acceptSocket_.fd())
+    , listenning_(false)
+    , exclusive_(true)
+{
+    acceptChannel_.setEventHandler(this);
+}
+
 Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll();    // 把从Poller中感兴趣的事件删除掉   update()取消
@@ -56,14 +111,21 @@ Acceptor::~Acceptor()
 void Acceptor::listen()
 {
     listenning_ = true;
-    acceptSocket_.listen();         // listen
-    acceptChannel_.enableReading(); // acceptChannel_注册至Poller !重要
+    acceptSocket_.listen();         // listen，共用socket时重复listen只是更新backlog
+    if (exclusive_)
+    {
+        acceptChannel_.enableExclusiveReading();
+    }
+    else
+    {
+        acceptChannel_.enableReading(); // acceptChannel_注册至Poller !重要
+    }
 }
 
 // 响应连接请求
 // listenfd有事件发生了，就是有新用户连接了
 // handleRead ->
-void Acceptor::handleRead()
+void Acceptor::handleRead(Timestamp)
 {
     InetAddress peerAddr;
     int connfd = acceptSocket_.accept(&peerAddr);  // socket接收，生成connectfd。实现为调用linux下的accept4，生成connectfd
@@ -84,6 +146,10 @@ void Acceptor::handleRead()
             ::close(connfd);
         }
     }
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+    {
+        // 连接已经被共用这个listen socket的其他loop取走了(EPOLLEXCLUSIVE也可能唤醒不止一个)
+    }
     else
     {
         // 陈硕的实现，是用一个dev/null空闲描述符
@@ -11,13 +11,17 @@ class InetAddress;
 
 
 // 对于多reactor模型来说，accrptor对应的就是主reactor
-class Acceptor : noncopyable
+class Acceptor final : noncopyable, public EventHandler
 {
 public:
     // 当连接到达时 就会使用这个回调，也叫做上层回调
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;  // 回调函数
 
-    Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
+    // ipv6Only只对ipv6地址有效，false时同一个socket也接受ipv4连接(对端地址为::ffff:a.b.c.d)
+    Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport, bool ipv6Only = false);
+    // 和shared共用同一个listen socket(dup出来的fd)，在loop中以EPOLLEXCLUSIVE监听，
+    // 多个loop同时在epoll_wait时一个新连接只唤醒其中一个，由它直接accept
+    Acceptor(EventLoop *loop, const Acceptor &shared);
     ~Acceptor();
 
     // 设置回调
@@ -27,11 +31,12 @@ public:
     void listen();
 
 private:
-    void handleRead();  // 是个回调函数
+    void handleRead(Timestamp receiveTime) override;  // listenfd可读，acceptChannel_直接调用
 
     EventLoop *loop_; // Acceptor用的就是用户定义的那个baseLoop 也称作mainLoop， 永远指向tcpserver传给我们的主loop
     Socket acceptSocket_;   // socket类
     Channel acceptChannel_;   // 一个文件描述符必定伴随一个channel
     NewConnectionCallback NewConnectionCallback_;  // 回调函数
     bool listenning_;
+    bool exclusive_;   // 以EPOLLEXCLUSIVE注册
 };
\ No newline at end of file
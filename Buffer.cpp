@@ -1,6 +1,12 @@
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BUFFER_HAVE_SIMD 1
+#endif
 
 #include "Buffer.h"
 
@@ -78,8 +84,139 @@ ssize_t Buffer::writeFd(int fd, int *saveErrno)
     return n;
 }
 
+/**
+ * 多字节分隔符的查找: 先用分隔符的首字节和尾字节同时过滤，
+ * 一次比较16/32个位置，只有首尾字节都匹配的位置才用memcmp确认
+ * 对于\r\n这样的两字节分隔符，首尾过滤之后就已经确认，不需要memcmp
+ **/
+static const char *searchScalar(const char *begin, const char *end, const char *delim, size_t len)
+{
+    const char *last = end - len;
+    for (const char *p = begin; p <= last; ++p)
+    {
+        p = static_cast<const char *>(::memchr(p, delim[0], last - p + 1));
+        if (p == nullptr)
+        {
+            return nullptr;
+        }
+        if (::memcmp(p + 1, delim + 1, len - 1) == 0)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef BUFFER_HAVE_SIMD
+// 对mask中的每个候选位置确认整个分隔符，返回第一个匹配
+static inline const char *checkCandidates(const char *p, unsigned mask, const char *delim, size_t len)
+{
+    while (mask != 0)
+    {
+        int i = __builtin_ctz(mask);
+        if (len <= 2 || ::memcmp(p + i + 1, delim + 1, len - 2) == 0)
+        {
+            return p + i;
+        }
+        mask &= mask - 1;
+    }
+    return nullptr;
+}
+
+__attribute__((target("sse2")))
+static const char *searchSSE2(const char *begin, const char *end, const char *delim, size_t len)
+{
+    const __m128i first = _mm_set1_epi8(delim[0]);
+    const __m128i last = _mm_set1_epi8(delim[len - 1]);
+    const char *p = begin;
+    // p + 15 + len - 1 < end，保证两次加载都不越界
+    for (; p + 16 + len - 1 <= end; p += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + len - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+        const char *found = checkCandidates(p, mask, delim, len);
+        if (found != nullptr)
+        {
+            return found;
+        }
+    }
+    return searchScalar(p, end, delim, len);   // 剩下不足一批的部分
+}
+
+__attribute__((target("avx2")))
+static const char *searchAVX2(const char *begin, const char *end, const char *delim, size_t len)
+{
+    const __m256i first = _mm256_set1_epi8(delim[0]);
+    const __m256i last = _mm256_set1_epi8(delim[len - 1]);
+    const char *p = begin;
+    for (; p + 32 + len - 1 <= end; p += 32)
+    {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + len - 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+        const char *found = checkCandidates(p, mask, delim, len);
+        if (found != nullptr)
+        {
+            return found;
+        }
+    }
+    return searchSSE2(p, end, delim, len);
+}
+#endif
+
+using SearchFunc = const char *(*)(const char *, const char *, const char *, size_t);
 
+// 启动时根据cpu支持的指令集选择一次
+static SearchFunc chooseSearch()
+{
+#ifdef BUFFER_HAVE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return searchAVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return searchSSE2;
+    }
+#endif
+    return searchScalar;
+}
 
+static const SearchFunc g_search = chooseSearch();
 
+const char *Buffer::search(const char *begin, const char *end, const char *delim, size_t len)
+{
+    if (len == 0 || begin + len > end)
+    {
+        return nullptr;
+    }
+    if (len == 1)   // 单字节的glibc memchr已经是向量化的
+    {
+        return static_cast<const char *>(::memchr(begin, delim[0], end - begin));
+    }
+    return g_search(begin, end, delim, len);
+}
+
+const char *Buffer::findWithMemo(const char *delim, size_t len) const
+{
+    size_t skip = 0;
+    if (len == searchDelimLen_ && ::memcmp(delim, searchDelim_, len) == 0)
+    {
+        // 之前扫描过的部分里没有完整的分隔符，但分隔符可能跨越已扫描部分的末尾
+        skip = searchedBytes_ >= len ? searchedBytes_ - (len - 1) : 0;
+    }
 
+    const char *found = search(peek() + skip, beginWrite(), delim, len);
 
+    if (len <= kMaxMemoDelim)
+    {
+        ::memcpy(searchDelim_, delim, len);
+        searchDelimLen_ = len;
+        searchedBytes_ = (found != nullptr) ? found - peek() : readableBytes();
+    }
+    return found;
+}
@@ -4,6 +4,9 @@
 #include <string>
 #include <algorithm>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
 
 // 网络库底层的缓冲区类型定义
 class Buffer
@@ -19,9 +22,21 @@ public:
         : buffer_(kCheapPrepend + initalSize)    // std::vector<char>, 8+1024
         , readerIndex_(kCheapPrepend)   //
         , writerIndex_(kCheapPrepend)
+        , searchedBytes_(0)
+        , searchDelimLen_(0)
     {
     }
 
+    // 交换两个Buffer的内容，不拷贝数据
+    void swap(Buffer &rhs)
+    {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        searchedBytes_ = 0;
+        rhs.searchedBytes_ = 0;
+    }
+
     // 计算长度   unsigned
     size_t readableBytes() const { return writerIndex_ - readerIndex_; }
     size_t writableBytes() const { return buffer_.size() - writerIndex_; }  // 可存放
@@ -34,6 +49,7 @@ public:
         if (len < readableBytes())  // 没取完
         {
             readerIndex_ += len; // 说明应用只读取了可读缓冲区数据的一部分，就是len长度 还剩下readerIndex+=len到writerIndex_的数据未读
+            searchedBytes_ = searchedBytes_ > len ? searchedBytes_ - len : 0;   // 查找记录是相对于peek()的
         }
         else // len == readableBytes()   取完
         {
@@ -44,6 +60,12 @@ public:
     {
         readerIndex_ = kCheapPrepend;
         writerIndex_ = kCheapPrepend;
+        searchedBytes_ = 0;
+    }
+    // 取到end为止，end一般是find系列函数的返回值
+    void retrieveUntil(const char *end)
+    {
+        retrieve(end - peek());
     }
 
     // 把onMessage函数上报的Buffer数据 转成string类型的数据返回
@@ -71,8 +93,65 @@ public:
         std::copy(data, data+len, beginWrite());
         writerIndex_ += len;
     }
+    void append(const std::string &str)
+    {
+        append(str.data(), str.size());
+    }
     char *beginWrite() { return begin() + writerIndex_; }
     const char *beginWrite() const { return begin() + writerIndex_; }
+    // 直接写入beginWrite()之后，调用hasWritten移动writerIndex_
+    void hasWritten(size_t len) { writerIndex_ += len; }
+
+    /**
+     * 网络字节序(大端)的整数读写
+     * append  追加到可读数据末尾
+     * peek    读取但不取走，调用方保证readableBytes()足够
+     * read    读取并取走
+     * prepend 写到可读数据之前，利用kCheapPrepend预留的空间，不移动已有数据
+     **/
+    void appendInt64(int64_t x) { uint64_t be = htobe64(static_cast<uint64_t>(x)); append(reinterpret_cast<const char *>(&be), sizeof be); }
+    void appendInt32(int32_t x) { uint32_t be = htobe32(static_cast<uint32_t>(x)); append(reinterpret_cast<const char *>(&be), sizeof be); }
+    void appendInt16(int16_t x) { uint16_t be = htobe16(static_cast<uint16_t>(x)); append(reinterpret_cast<const char *>(&be), sizeof be); }
+    void appendInt8(int8_t x) { append(reinterpret_cast<const char *>(&x), sizeof x); }
+
+    int64_t peekInt64() const { uint64_t be; ::memcpy(&be, peek(), sizeof be); return static_cast<int64_t>(be64toh(be)); }
+    int32_t peekInt32() const { uint32_t be; ::memcpy(&be, peek(), sizeof be); return static_cast<int32_t>(be32toh(be)); }
+    int16_t peekInt16() const { uint16_t be; ::memcpy(&be, peek(), sizeof be); return static_cast<int16_t>(be16toh(be)); }
+    int8_t peekInt8() const { return static_cast<int8_t>(*peek()); }
+
+    int64_t readInt64() { int64_t x = peekInt64(); retrieve(sizeof x); return x; }
+    int32_t readInt32() { int32_t x = peekInt32(); retrieve(sizeof x); return x; }
+    int16_t readInt16() { int16_t x = peekInt16(); retrieve(sizeof x); return x; }
+    int8_t readInt8() { int8_t x = peekInt8(); retrieve(sizeof x); return x; }
+
+    // 调用方保证prependableBytes() >= len
+    void prepend(const void *data, size_t len)
+    {
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+        searchedBytes_ = 0;
+    }
+    void prependInt64(int64_t x) { uint64_t be = htobe64(static_cast<uint64_t>(x)); prepend(&be, sizeof be); }
+    void prependInt32(int32_t x) { uint32_t be = htobe32(static_cast<uint32_t>(x)); prepend(&be, sizeof be); }
+    void prependInt16(int16_t x) { uint16_t be = htobe16(static_cast<uint16_t>(x)); prepend(&be, sizeof be); }
+    void prependInt8(int8_t x) { prepend(&x, sizeof x); }
+
+    /**
+     * 在可读区域中查找分隔符，找不到返回nullptr
+     * 不带start参数的版本会记住上一次查找同一个分隔符时已经扫描过的位置，
+     * 消息不完整时，下一次handleRead之后只扫描新到的数据，不会从头重新扫描
+     * 带start参数的版本从start开始查找，不使用也不更新记录
+     * 有SSE2/AVX2时按16/32字节一批比较，否则逐字节查找
+     **/
+    const char *findCRLF() const { return findWithMemo("\r\n", 2); }
+    const char *findCRLF(const char *start) const { return search(start, beginWrite(), "\r\n", 2); }
+    const char *findEOL() const { return findWithMemo("\n", 1); }
+    const char *findEOL(const char *start) const { return search(start, beginWrite(), "\n", 1); }
+    const char *find(const char *delim, size_t len) const { return findWithMemo(delim, len); }
+    const char *find(const char *start, const char *delim, size_t len) const { return search(start, beginWrite(), delim, len); }
+
+    // 在[begin, end)中查找长度为len的delim，找不到返回nullptr
+    static const char *search(const char *begin, const char *end, const char *delim, size_t len);
 
     // 从fd上读取数据
     ssize_t readFd(int fd, int *saveErrno);
@@ -106,9 +185,17 @@ private:
         }
     }
 
+    const char *findWithMemo(const char *delim, size_t len) const;
+
     std::vector<char> buffer_;
     size_t readerIndex_;
     size_t writerIndex_;
+
+    // 查找记录：从peek()开始的searchedBytes_个字节中没有完整的searchDelim_
+    static const size_t kMaxMemoDelim = 16;
+    mutable size_t searchedBytes_;
+    mutable size_t searchDelimLen_;
+    mutable char searchDelim_[kMaxMemoDelim];
 };
 
 
@@ -12,18 +12,45 @@
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::kWriteEvent = EPOLLOUT;
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)   // Linux 4.5，老的头文件没有定义
+#endif
+// 内核不允许EPOLLEXCLUSIVE和EPOLLPRI一起使用
+const int Channel::kExclusiveReadEvent = EPOLLIN | EPOLLEXCLUSIVE;
 
 
 Channel::Channel(EventLoop *loop, int fd) :
+        handler_(nullptr),
         loop_(loop),
         fd_(fd),
         events_(0),
         revents_(0),
         index_(-1),
-        tied_(false) {}
+        tied_(false),
+        pendingUpdate_(false),
+        registeredEvents_(0) {}
 
+static_assert(sizeof(Channel) <= 64, "Channel hot fields should fit in one cache line");
+
+Channel::Callbacks &Channel::callbacks() {
+    if (!callbacks_) {
+        callbacks_.reset(new Callbacks);
+    }
+    return *callbacks_;
+}
 
-Channel::~Channel() {}
+
+// 还在Poller中(channels_或者待更新列表)就析构，Poller会留下悬空指针，下一轮epoll_wait之前访问到它
+// 所有者应该先disableAll、remove；忘了的话在所属loop中补上，在其他线程中无法安全地修改Poller，直接退出
+Channel::~Channel() {
+    if (index_ != -1 || pendingUpdate_) {
+        if (!loop_->isInLoopThread()) {
+            LOG_FATAL("Channel::~Channel fd=%d destroyed outside its loop while still in the poller\n", fd_);
+        }
+        LOG_ERROR("Channel::~Channel fd=%d destroyed without remove()\n", fd_);
+        remove();
+    }
+}
 
 /** channel 的 tie()方法， TcpConnection => Channel 时候调用
  *
@@ -74,43 +101,79 @@ void Channel::handleEvent(TimeStamp receiveTime) {
 
 // 根据fd上发生的事件，来判断返回的事件是什么
 void Channel::handleEventWithGuard(TimeStamp receiveTime){  // 根据fd上发生的事件判断返回的事件是什么
-    LOG_INFO("channel handleEvent revents:%d\n", revents_);
+    LOG_DEBUG("channel handleEvent revents:%d\n", revents_);  // 每个事件都会执行，不能用LOG_INFO
+    if (handler_ != nullptr)
+    {
+        handleEventWithHandler(receiveTime);
+        return;
+    }
+    if (!callbacks_)
+    {
+        return;
+    }
+    const Callbacks &cbs = *callbacks_;
     // 关闭
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) // 当TcpConnection对应Channel 通过shutdown 关闭写端 epoll触发EPOLLHUP
     {
-        if (closeCallback_)
+        if (cbs.close)
         {
-            closeCallback_();
+            cbs.close();
         }
     }
     // 错误
     if (revents_ & EPOLLERR)
     {
-        if (errorCallback_)
+        if (cbs.errorQueue)
+        {
+            cbs.errorQueue();
+        }
+        else if (cbs.error)
         {
-            errorCallback_();
+            cbs.error();
         }
     }
     // 读
     if (revents_ & (EPOLLIN | EPOLLPRI))
     {
-        if (readCallback_)
+        if (cbs.read)
         {
-            readCallback_(receiveTime);
+            cbs.read(receiveTime);
         }
     }
     // 写
     if (revents_ & EPOLLOUT)
     {
-        if (writeCallback_)
+        if (cbs.write)
         {
-            writeCallback_();
+            cbs.write();
         }
     }
 }
 
-
-
-
-
-
+// 和handleEventWithGuard的判断顺序一致，只是换成对handler_的虚函数调用
+void Channel::handleEventWithHandler(TimeStamp receiveTime)
+{
+    if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
+    {
+        handler_->handleClose();
+    }
+    if (revents_ & EPOLLERR)
+    {
+        if (callbacks_ && callbacks_->errorQueue)
+        {
+            callbacks_->errorQueue();
+        }
+        else
+        {
+            handler_->handleError();
+        }
+    }
+    if (revents_ & (EPOLLIN | EPOLLPRI))
+    {
+        handler_->handleRead(receiveTime);
+    }
+    if (revents_ & EPOLLOUT)
+    {
+        handler_->handleWrite();
+    }
+}
@@ -10,6 +10,8 @@
 #include "nonCopyable.h"
 #include "Channel.h"
 #include "TimeStamp.h"
+#include "SlabPool.h"
+#include "EventHandler.h"
 
 class EventLoop;
 
@@ -28,6 +30,10 @@ public:
     Channel(EventLoop* loop, int fd);
     ~Channel();
 
+    // 随连接频繁创建销毁，从所在线程的内存池分配
+    static void *operator new(size_t size){return SlabPool::allocate(size);}
+    static void operator delete(void *p){SlabPool::deallocate(p);}
+
     /** fd 得到 poller 通知后，调用EventLoop::loop() 来执行handleEvent
      * handleEvent 是 Channel 的核心
      */
@@ -36,13 +42,18 @@ public:
     /**
      * 设置回调函数的对象
      * */
-    void setReadCallback(ReadEventCallback cb){readCallback_ = std::move(cb);}
-    void setWriteCallback(EventCallback cb){writeCallback_ = std::move(cb);}
-    void setErrorCallback(EventCallback cb){errorCallback_ = std::move(cb);}
-    void setCloseCallback(EventCallback cb){closeCallback_ = std::move(cb);}
+    void setReadCallback(ReadEventCallback cb){callbacks().read = std::move(cb);}
+    void setWriteCallback(EventCallback cb){callbacks().write = std::move(cb);}
+    void setErrorCallback(EventCallback cb){callbacks().error = std::move(cb);}
+    void setCloseCallback(EventCallback cb){callbacks().close = std::move(cb);}
+    // 设置后EPOLLERR先交给它读socket的错误队列(MSG_ERRQUEUE)，比如MSG_ZEROCOPY的完成通知，
+    // 是不是真正的错误由回调自己判断，不再调用errorCallback_
+    void setErrorQueueCallback(EventCallback cb){callbacks().errorQueue = std::move(cb);}
+    // 设置后事件直接分发给handler，不再使用上面的读/写/关闭/错误回调，handler的生命周期由调用方保证
+    void setEventHandler(EventHandler *handler){handler_ = handler;}
 
     // 防止当channel被手动remove掉， channel还在继续执行回调
-    //TODO： TCP
+    // 每个事件都要lock一次weak_ptr，TcpConnection改为自己持有引用直到connectDestroyed，不再使用tie
     void tie(const std::shared_ptr<void>&);
 
     int fd() const{return fd_;}
@@ -57,6 +68,9 @@ public:
     void enableWriting(){events_ |= kWriteEvent; update();}
     void disableWriting(){events_ &= ~kWriteEvent; update();}
     void disableAll(){events_ = kNoneEvent; update();}
+    // 和其他epoll实例共享的fd(比如同一个listenfd注册到每个subloop)，事件发生时内核只唤醒其中一个等待者
+    // EPOLLEXCLUSIVE只能在注册时指定，之后不能再修改事件，只能disableAll
+    void enableExclusiveReading(){events_ |= kExclusiveReadEvent; update();}
 
     /**
      * 返回fd当前的事件状态
@@ -68,6 +82,12 @@ public:
     int index(){return index_;}
     void set_index(int index){index_ = index;}
 
+    // 下面两组只给Poller用：是否在Poller的待更新列表中、已经注册到内核的事件
+    bool pendingUpdate() const{return pendingUpdate_;}
+    void setPendingUpdate(bool on){pendingUpdate_ = on;}
+    int registeredEvents() const{return registeredEvents_;}
+    void setRegisteredEvents(int ev){registeredEvents_ = ev;}
+
     /**
      * one loop per thread
      * */
@@ -75,30 +95,45 @@ public:
      void remove();
 
 private:
-    ReadEventCallback readCallback_;
-    EventCallback writeCallback_;
-    EventCallback errorCallback_;
-    EventCallback closeCallback_;
-
     // 标记位
     static const int kNoneEvent; // disableAll 的标记位
     static const int kReadEvent;
     static const int kWriteEvent;
+    static const int kExclusiveReadEvent;
+
+    // std::function回调只有用户代码和少数内部Channel使用，单独分配，不占Channel的cache line
+    struct Callbacks
+    {
+        ReadEventCallback read;
+        EventCallback write;
+        EventCallback error;
+        EventCallback close;
+        EventCallback errorQueue;
+    };
+    Callbacks &callbacks();   // 第一次设置回调时分配
 
-
+    /**
+     * 下面的成员都是每个事件要访问的，一共64字节，正好一个cache line：
+     * Poller填revents_、读写events_/index_/fd_，handleEvent读tied_/tie_/handler_
+     * 按对齐要求从大到小排列，中间没有空洞
+     * */
+    EventHandler *handler_;  // 不为空时优先于std::function回调
     EventLoop* loop_;  // 事件循环
+    std::weak_ptr<void> tie_;  // muduo中的弱回调，改变对象的生命周期问题
+    std::unique_ptr<Callbacks> callbacks_;
     const int fd_;  // poller监听的对象
     int events_; // 注册fd感兴趣的事件
     int revents_;  // poller返回的具体发生的事件
     int index_;  // used by poller, 对于我们所使用的Epoll， 表示 kNew, kAdded, kDeleted
-
-    std::weak_ptr<void> tie_;  // muduo中的弱回调，改变对象的生命周期问题
     bool tied_;  // a对象调用b对象，b对象还没销毁，但是a马上要销毁，那么来延长生命周期
+    bool pendingUpdate_;  // 已经在Poller的待更新列表中
+    int registeredEvents_;  // 已经通过epoll_ctl注册到内核的事件
 
     // Channel::update() => EventLoop::updateChannel() => Poller::updateChannel()
     void update();
 
 
     void handleEventWithGuard(TimeStamp receiveTime);
+    void handleEventWithHandler(TimeStamp receiveTime);
 };
 
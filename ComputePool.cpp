@@ -0,0 +1,139 @@
+#include "ComputePool.h"
+#include "Thread.h"
+#include "Logger.h"
+
+// 当前线程是哪个池的第几个工作线程，工作线程中提交的任务放回自己的队列
+static __thread ComputePool *t_pool = nullptr;
+static __thread size_t t_workerIndex = 0;
+
+ComputePool::ComputePool(const std::string &name, int numThreads, size_t maxQueued)
+    : name_(name)
+    , maxQueued_(maxQueued)
+    , next_(0)
+    , queued_(0)
+    , rejected_(0)
+    , stolen_(0)
+    , started_(false)
+    , stopping_(false)
+{
+    if (numThreads < 1)
+    {
+        numThreads = 1;
+    }
+    for (int i = 0; i < numThreads; ++i)
+    {
+        workers_.emplace_back(new Worker);
+    }
+}
+
+ComputePool::~ComputePool()
+{
+    stop();
+}
+
+void ComputePool::start()
+{
+    started_ = true;
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        workers_[i]->thread.reset(
+            new Thread(std::bind(&ComputePool::threadFunc, this, i), name_ + std::to_string(i)));
+        workers_[i]->thread->start();
+    }
+}
+
+void ComputePool::stop()
+{
+    if (!started_ || stopping_.exchange(true))
+    {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+    }
+    cond_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker->thread->join();
+    }
+}
+
+bool ComputePool::submit(Task task)
+{
+    // 先占名额再入队，超过上限的直接拒绝
+    // 占名额之后才检查stopping_：工作线程看到stopping_且queued_为0才退出，占了名额的任务要么被拒绝要么一定会执行
+    if (queued_.fetch_add(1) >= maxQueued_ || stopping_)
+    {
+        queued_.fetch_sub(1);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t index = t_pool == this ? t_workerIndex : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        std::unique_lock<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // 和等待方的检查互斥，不会在它检查完、还没睡下时通知而丢失唤醒
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+    }
+    cond_.notify_one();
+    return true;
+}
+
+// 自己的队列从头部取，先提交的先执行
+bool ComputePool::popLocal(size_t index, Task *task)
+{
+    Worker &worker = *workers_[index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+    {
+        return false;
+    }
+    *task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    return true;
+}
+
+// 从其他队列的尾部偷，和队列主人从头部取的位置错开
+bool ComputePool::steal(size_t index, Task *task)
+{
+    for (size_t i = 1; i < workers_.size(); ++i)
+    {
+        Worker &victim = *workers_[(index + i) % workers_.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            *task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ComputePool::threadFunc(size_t index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+    while (true)
+    {
+        Task task;
+        if (popLocal(index, &task) || steal(index, &task))
+        {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            continue;
+        }
+        // 名额已占但任务还没放进队列时queued_也大于0，这时不睡，重新找一遍
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        cond_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_relaxed) > 0; });
+        if (stopping_ && queued_.load() == 0)
+        {
+            break;
+        }
+    }
+    LOG_DEBUG("ComputePool %s worker %zu exit\n", name_.c_str(), index);
+}
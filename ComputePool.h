@@ -0,0 +1,96 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+
+#include "noncopyable.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+
+class Thread;
+
+/**
+ * 计算线程池，把耗CPU的处理(比如几毫秒的JSON转换)从IO loop中挪出去，loop上的其他连接不再被它拖住
+ * 和EventLoopThreadPool无关，工作线程不跑EventLoop
+ * 每个工作线程一个任务队列：外部线程提交时轮流放入各个队列，工作线程在自己的队列中提交时放回自己的队列，
+ * 自己的队列空了就从其他队列的尾部偷任务，忙闲不均时空闲的线程会分担
+ * 排队的任务总数有上限，超过时submit返回false，由调用方决定怎么拒绝(比如回复繁忙、断开连接)，内存不会无限增长
+ *
+ *   pool.submit(conn, [data] { return transform(data); },
+ *               [](const TcpConnectionPtr &conn, std::string result) { conn->send(result); });
+ * */
+class ComputePool : noncopyable
+{
+public:
+    using Task = std::function<void()>;
+
+    ComputePool(const std::string &name, int numThreads, size_t maxQueued);
+    ~ComputePool();   // 等待已经提交的任务执行完
+
+    void start();
+    void stop();
+
+    // 任意线程都可以调用，队列满或者已经stop时返回false
+    bool submit(Task task);
+
+    // 在工作线程中执行work()，结果通过loop->queueInLoop交给done(result)，done在loop线程中执行
+    template <typename Work, typename Done>
+    bool submit(EventLoop *loop, Work work, Done done)
+    {
+        return submit([loop, work = std::move(work), done = std::move(done)]() mutable {
+            auto result = work();
+            loop->queueInLoop([done = std::move(done), result = std::move(result)]() mutable {
+                done(std::move(result));
+            });
+        });
+    }
+
+    // 同上，结果回到连接所属的loop，done(conn, result)，期间连接对象不会析构(可能已经断开)
+    template <typename Work, typename Done>
+    bool submit(const TcpConnectionPtr &conn, Work work, Done done)
+    {
+        using Result = decltype(work());
+        return submit(conn->getLoop(), std::move(work), [conn, done = std::move(done)](Result result) mutable {
+            done(conn, std::move(result));
+        });
+    }
+
+    const std::string &name() const { return name_; }
+    size_t queued() const { return queued_.load(std::memory_order_relaxed); }
+    int64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    int64_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::unique_ptr<Thread> thread;
+    };
+
+    void threadFunc(size_t index);
+    bool popLocal(size_t index, Task *task);
+    bool steal(size_t index, Task *task);
+
+    const std::string name_;
+    const size_t maxQueued_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_;      // 外部提交时轮流选择的队列
+    std::atomic<size_t> queued_;    // 所有队列中的任务数，包括已经占了名额还没放进队列的
+    std::atomic<int64_t> rejected_;
+    std::atomic<int64_t> stolen_;
+    bool started_;
+    std::atomic_bool stopping_;
+
+    // 所有队列都空时工作线程在这里等待
+    std::mutex sleepMutex_;
+    std::condition_variable cond_;
+};
@@ -0,0 +1,230 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+static int createNonblocking(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d connect socket create err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+static int getSocketError(int sockfd)
+{
+    int optval;
+    socklen_t optlen = sizeof optval;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    {
+        return errno;
+    }
+    return optval;
+}
+
+// 连接本机时，端口在临时端口范围内可能会和自己连上(自连接)，本地地址和对端地址相同
+static bool isSelfConnect(int sockfd)
+{
+    sockaddr_in6 local, peer;   // 能放下ipv4和ipv6的地址
+    socklen_t len = sizeof local;
+    ::memset(&local, 0, sizeof local);
+    ::memset(&peer, 0, sizeof peer);
+    if (::getsockname(sockfd, (sockaddr *)&local, &len) < 0)
+    {
+        return false;
+    }
+    len = sizeof peer;
+    if (::getpeername(sockfd, (sockaddr *)&peer, &len) < 0)
+    {
+        return false;
+    }
+    if (local.sin6_family == AF_INET6)
+    {
+        return local.sin6_port == peer.sin6_port
+               && ::memcmp(&local.sin6_addr, &peer.sin6_addr, sizeof local.sin6_addr) == 0;
+    }
+    const sockaddr_in *local4 = reinterpret_cast<const sockaddr_in *>(&local);
+    const sockaddr_in *peer4 = reinterpret_cast<const sockaddr_in *>(&peer);
+    return local4->sin_family == AF_INET   // unix域socket不会自连接
+           && local4->sin_port == peer4->sin_port && local4->sin_addr.s_addr == peer4->sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , initRetryDelayMs_(kInitRetryDelayMs)
+    , maxRetryDelayMs_(kMaxRetryDelayMs)
+    , retryDelayMs_(kInitRetryDelayMs)
+    , retryTimer_(0)
+{
+}
+
+Connector::~Connector()
+{
+}
+
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    if (connect_)
+    {
+        connect();
+    }
+}
+
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    loop_->cancel(retryTimer_);   // 取消还在等待的重试
+    if (state_ == kConnecting)
+    {
+        setState(kDisconnected);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+    }
+}
+
+void Connector::restart()
+{
+    setState(kDisconnected);
+    retryDelayMs_ = initRetryDelayMs_;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::connect()
+{
+    int sockfd = createNonblocking(serverAddr_.family());
+    int ret = ::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.getSockLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+        case 0:
+        case EINPROGRESS:   // 非阻塞connect正在进行
+        case EINTR:
+        case EISCONN:
+            connecting(sockfd);
+            break;
+
+        // 这些错误可能是暂时的，重试
+        case EAGAIN:
+        case EADDRINUSE:
+        case EADDRNOTAVAIL:
+        case ECONNREFUSED:
+        case ENETUNREACH:
+        case ENOENT:   // unix域socket的文件还不存在，服务端可能还没启动
+            retry(sockfd);
+            break;
+
+        default:
+            LOG_ERROR("Connector::connect error:%d\n", savedErrno);
+            ::close(sockfd);
+            break;
+    }
+}
+
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(
+        std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(
+        std::bind(&Connector::handleError, this));
+    channel_->enableWriting();   // 连接建立(或失败)时socket变为可写
+}
+
+int Connector::removeAndResetChannel()
+{
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 当前可能正处于channel_->handleEvent中，不能在这里释放channel_
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel()
+{
+    channel_.reset();
+}
+
+void Connector::handleWrite()
+{
+    if (state_ == kConnecting)
+    {
+        int sockfd = removeAndResetChannel();   // sockfd交给TcpConnection，不再由Connector关注
+        int err = getSocketError(sockfd);
+        if (err)
+        {
+            LOG_ERROR("Connector::handleWrite - SO_ERROR = %d\n", err);
+            retry(sockfd);
+        }
+        else if (isSelfConnect(sockfd))
+        {
+            LOG_ERROR("Connector::handleWrite - Self connect\n");
+            retry(sockfd);
+        }
+        else
+        {
+            setState(kConnected);
+            retryDelayMs_ = initRetryDelayMs_;
+            if (connect_ && newConnectionCallback_)
+            {
+                newConnectionCallback_(sockfd);
+            }
+            else
+            {
+                ::close(sockfd);
+            }
+        }
+    }
+}
+
+void Connector::handleError()
+{
+    LOG_ERROR("Connector::handleError state=%d\n", (int)state_);
+    if (state_ == kConnecting)
+    {
+        int sockfd = removeAndResetChannel();
+        int err = getSocketError(sockfd);
+        LOG_ERROR("Connector::handleError SO_ERROR = %d\n", err);
+        retry(sockfd);
+    }
+}
+
+// 关闭失败的socket，retryDelayMs_之后重新connect，间隔每次翻倍，最大maxRetryDelayMs_
+void Connector::retry(int sockfd)
+{
+    ::close(sockfd);
+    setState(kDisconnected);
+    if (connect_)
+    {
+        LOG_INFO("Connector::retry - Retry connecting to %s in %d milliseconds\n",
+                 serverAddr_.toIpPort().c_str(), retryDelayMs_);
+        retryTimer_ = loop_->runAfter(retryDelayMs_,
+                                      std::bind(&Connector::startInLoop, shared_from_this()));
+        retryDelayMs_ = std::min(retryDelayMs_ * 2, maxRetryDelayMs_);
+    }
+}
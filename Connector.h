@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Timer.h"
+
+class Channel;
+class EventLoop;
+
+/**
+ * 主动发起连接，是Acceptor的对应物
+ * 非阻塞connect返回EINPROGRESS后，把socket注册到loop上关注可写事件，
+ * 可写时用SO_ERROR判断连接是否成功；失败则按指数退避重试
+ * 连接成功后把sockfd交给上层(TcpClient)，由上层创建TcpConnection
+ * */
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+
+    const InetAddress &serverAddress() const { return serverAddr_; }
+
+    // 重试的初始间隔和最大间隔，默认500ms和30s
+    void setRetryDelay(int initRetryDelayMs, int maxRetryDelayMs)
+    {
+        initRetryDelayMs_ = initRetryDelayMs;
+        maxRetryDelayMs_ = maxRetryDelayMs;
+        retryDelayMs_ = initRetryDelayMs;
+    }
+
+    void start();     // 可以跨线程调用
+    void restart();   // 只能在loop线程中调用
+    void stop();      // 可以跨线程调用
+
+private:
+    enum StateE
+    {
+        kDisconnected,
+        kConnecting,
+        kConnected
+    };
+    static const int kInitRetryDelayMs = 500;
+    static const int kMaxRetryDelayMs = 30 * 1000;
+
+    void setState(StateE s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);   // 连接正在进行，等待可写事件
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;   // 是否需要连接，stop之后为false
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_;   // 只在连接进行中存在
+    NewConnectionCallback newConnectionCallback_;
+    int initRetryDelayMs_;
+    int maxRetryDelayMs_;
+    int retryDelayMs_;   // 当前的重试间隔，每次失败翻倍
+    TimerId retryTimer_;
+};
@@ -0,0 +1,108 @@
+#include <utility>
+
+#include "Coroutine.h"
+#include "Logger.h"
+
+void CoTask::promise_type::unhandled_exception()
+{
+    // 没有人等待结果，异常无处传递
+    LOG_FATAL("CoTask: unhandled exception in coroutine\n");
+}
+
+CoConnection::CoConnection(const TcpConnectionPtr &conn)
+    : conn_(conn)
+    , state_(std::make_shared<State>(conn.get()))
+{
+    state_->closed = !conn->connected();
+    conn->setMessageCallback(std::bind(&CoConnection::onMessage, state_,
+                                       std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    conn->setWriteCompleteCallback(std::bind(&CoConnection::onWriteComplete, state_, std::placeholders::_1));
+    conn->setConnectionCallback(std::bind(&CoConnection::onConnection, state_, std::placeholders::_1));
+}
+
+CoConnection::ReadAwaiter CoConnection::read(size_t n)
+{
+    state_->need = n;
+    state_->delim.clear();
+    return ReadAwaiter(state_.get());
+}
+
+CoConnection::ReadAwaiter CoConnection::readUntil(const std::string &delim)
+{
+    state_->delim = delim;
+    return ReadAwaiter(state_.get());
+}
+
+CoConnection::WriteAwaiter CoConnection::write(const std::string &data)
+{
+    bool sent = !state_->closed && conn_->connected();
+    if (sent)
+    {
+        conn_->send(data);   // 在loop线程中，直接写socket，写不完的留在outputBuffer
+    }
+    return WriteAwaiter(state_.get(), sent);
+}
+
+bool CoConnection::State::readable() const
+{
+    Buffer *input = conn->inputBuffer();
+    if (delim.empty())
+    {
+        return input->readableBytes() >= need;
+    }
+    return input->find(delim.data(), delim.size()) != nullptr;
+}
+
+std::optional<std::string> CoConnection::State::take()
+{
+    if (!readable())
+    {
+        return std::nullopt;   // 只有连接断开时才会在数据不够的情况下恢复
+    }
+    Buffer *input = conn->inputBuffer();
+    if (delim.empty())
+    {
+        return input->retrieveAsString(need);
+    }
+    const char *end = input->find(delim.data(), delim.size());
+    std::string result(input->peek(), end);
+    input->retrieveUntil(end + delim.size());
+    return result;
+}
+
+void CoConnection::onMessage(const std::shared_ptr<State> &state, const TcpConnectionPtr &, Buffer *, Timestamp)
+{
+    if (state->reader && state->readable())
+    {
+        std::exchange(state->reader, nullptr).resume();
+    }
+}
+
+void CoConnection::onWriteComplete(const std::shared_ptr<State> &state, const TcpConnectionPtr &)
+{
+    // 之前一次直接写完的发送也会排队一个发送完成回调，缓冲区确实空了才恢复
+    if (state->writer && state->drained())
+    {
+        std::exchange(state->writer, nullptr).resume();
+    }
+}
+
+void CoConnection::onConnection(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        return;
+    }
+    state->closed = true;
+    // 先都取下来，恢复reader之后协程可能结束，CoConnection随之析构
+    std::coroutine_handle<> reader = std::exchange(state->reader, nullptr);
+    std::coroutine_handle<> writer = std::exchange(state->writer, nullptr);
+    if (reader)
+    {
+        reader.resume();
+    }
+    if (writer)
+    {
+        writer.resume();
+    }
+}
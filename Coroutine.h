@@ -0,0 +1,128 @@
+#pragma once
+
+/**
+ * 可选的C++20协程层，只有C++20的目标(CMakeLists.txt中的mymuduo_coro)才能包含这个头文件，库的其他部分仍然是C++14
+ * 多步骤的协议不用再在MessageCallback里手写状态机，每次handleRead后从头解析Buffer：
+ *
+ *   CoTask session(TcpConnectionPtr conn)
+ *   {
+ *       CoConnection stream(conn);
+ *       while (std::optional<std::string> line = co_await stream.readUntil("\r\n"))
+ *       {
+ *           co_await conn->getLoop()->sleep(10);
+ *           if (!co_await stream.write(*line + "\r\n"))
+ *           {
+ *               break;
+ *           }
+ *       }
+ *   }
+ *   server.setConnectionCallback([](const TcpConnectionPtr &conn) { if (conn->connected()) session(conn); });
+ *
+ * 协程总是在连接所属的loop线程中恢复(数据到达、发送完成、连接断开、定时器到期)，没有线程切换
+ * 协程帧从loop线程的SlabPool分配
+ **/
+#if __cplusplus < 202002L
+#error "Coroutine.h requires C++20, build with the mymuduo_coro target"
+#endif
+
+#include <coroutine>
+#include <optional>
+#include <string>
+#include <memory>
+
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "SlabPool.h"
+
+// 不需要等待结果的协程，返回类型写成CoTask即可
+// 调用时立即执行到第一个挂起点，执行完后自动释放协程帧；需要在loop线程中调用，一般在连接回调里
+class CoTask
+{
+public:
+    struct promise_type
+    {
+        CoTask get_return_object() { return CoTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+
+        static void *operator new(size_t size) { return SlabPool::allocate(size); }
+        static void operator delete(void *p) { SlabPool::deallocate(p); }
+    };
+};
+
+/**
+ * 把一个TcpConnection的读写变成可以co_await的操作，在loop线程中构造(一般在协程开头)
+ * 构造后接管连接的消息回调、发送完成回调和连接回调，一个连接同时只能有一个CoConnection
+ * 没有协程在等待时收到的数据留在inputBuffer中，readUntil只扫描新到的数据(Buffer::find会记住扫描过的位置)
+ * */
+class CoConnection
+{
+private:
+    struct State;
+
+public:
+    explicit CoConnection(const TcpConnectionPtr &conn);
+
+    // co_await得到std::optional<std::string>，连接断开且剩下的数据不够时为空
+    class ReadAwaiter
+    {
+    public:
+        // 已经断开时不挂起，否则没有人再恢复这个协程
+        bool await_ready() const { return state_->closed || state_->readable(); }
+        void await_suspend(std::coroutine_handle<> handle) { state_->reader = handle; }
+        std::optional<std::string> await_resume() { return state_->take(); }
+
+    private:
+        friend class CoConnection;
+        explicit ReadAwaiter(State *state) : state_(state) {}
+        State *state_;
+    };
+
+    // co_await得到bool，数据全部交给内核后为true，连接断开时为false
+    class WriteAwaiter
+    {
+    public:
+        bool await_ready() const { return !sent_ || state_->drained(); }
+        void await_suspend(std::coroutine_handle<> handle) { state_->writer = handle; }
+        bool await_resume() const { return sent_ && !state_->closed; }
+
+    private:
+        friend class CoConnection;
+        WriteAwaiter(State *state, bool sent) : state_(state), sent_(sent) {}
+        State *state_;
+        bool sent_;
+    };
+
+    ReadAwaiter read(size_t n);   // 恰好n个字节
+    ReadAwaiter readUntil(const std::string &delim);   // 到delim为止，不含delim，delim被一起取走
+    WriteAwaiter write(const std::string &data);   // 立即发送，发送缓冲区排空后恢复
+
+    const TcpConnectionPtr &connection() const { return conn_; }
+
+private:
+    // 连接的回调持有State，协程持有CoConnection，CoConnection持有连接，没有循环引用
+    struct State
+    {
+        explicit State(TcpConnection *connArg) : conn(connArg), need(0), closed(false) {}
+
+        bool readable() const;
+        std::optional<std::string> take();
+        bool drained() const { return conn->outputBuffer()->readableBytes() == 0; }
+
+        TcpConnection *conn;
+        std::coroutine_handle<> reader;   // 等待读的协程
+        std::coroutine_handle<> writer;   // 等待发送完成的协程
+        size_t need;          // read(n)
+        std::string delim;    // readUntil，为空时是read(n)
+        bool closed;
+    };
+
+    static void onMessage(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn, Buffer *buf, Timestamp);
+    static void onWriteComplete(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn);
+    static void onConnection(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn);
+
+    TcpConnectionPtr conn_;
+    std::shared_ptr<State> state_;
+};
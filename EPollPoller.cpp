@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <string.h>
+#include <algorithm>
 
 #include "EPollPoller.h"
 #include "Logger.h"
@@ -15,6 +16,9 @@ EPollPoller::EPollPoller(EventLoop *loop)
         : Poller(loop)
         , epollfd_(::epoll_create1(EPOLL_CLOEXEC))
         , events_(kInitEventListSize) // vector<epoll_event>(16) 存放了一系列events的fd
+        , initEvents_(kInitEventListSize)
+        , maxEvents_(kMaxEventSize)
+        , lowActivityPolls_(0)
 {
     if (epollfd_ < 0)
     {
@@ -31,7 +35,9 @@ EPollPoller::~EPollPoller()
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
     // 由于频繁调用poll 实际上应该用LOG_DEBUG输出日志更为合理 当遇到并发场景 关闭DEBUG日志提升效率
-    LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+    LOG_DEBUG("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+
+    applyPendingUpdates();
 
     // epoll_wait 去等待和监听在epoll上面注册的事件是否发生，
     // 当有事件发生的时候， 会获取有多少事件发生    并会获取当前时间
@@ -41,16 +47,14 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 
     if (numEvents > 0)  // 有事件发生
     {
-        LOG_INFO("%d events happend\n", numEvents); // LOG_DEBUG最合理
+        LOG_DEBUG("%d events happend\n", numEvents);
         fillActiveChannels(numEvents, activeChannels);  // pool进行填充
-        if (numEvents == events_.size()) // 扩容操作
-        {
-            events_.resize(events_.size() * 2);
-        }
+        adjustEventList(numEvents);
     }
     else if (numEvents == 0)  // 超时
     {
         LOG_DEBUG("%s timeout!\n", __FUNCTION__);
+        adjustEventList(0);   // 空闲和忙轮询时大多是0个事件，也要算作低活跃，否则数组不会缩回去
     }
     else
     {
@@ -63,49 +67,90 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
     return now;
 }
 
-// channel update remove => EventLoop updateChannel removeChannel => Poller updateChannel removeChannel
-// 向epoll中更新数据
-void EPollPoller::updateChannel(Channel *channel)
+void EPollPoller::setEventListLimits(int initialEvents, int maxEvents)
 {
-    const int index = channel->index();
-    LOG_INFO("func=%s => fd=%d events=%d index=%d\n", __FUNCTION__, channel->fd(), channel->events(), index);
+    initEvents_ = static_cast<size_t>(std::max(initialEvents, 1));
+    maxEvents_ = std::max(static_cast<size_t>(maxEvents), initEvents_);
+    lowActivityPolls_ = 0;
+    resizeEventList(std::min(std::max(events_.size(), initEvents_), maxEvents_));
+}
 
-    if (index == kNew || index == kDeleted)
+// 用新的vector替换，缩小时才会真正释放内存
+void EPollPoller::adjustEventList(int numEvents)
+{
+    size_t size = events_.size();
+    if (static_cast<size_t>(numEvents) == size) // 扩容操作，不超过maxEvents_
     {
-        if (index == kNew)
+        lowActivityPolls_ = 0;
+        if (size < maxEvents_)
         {
-            int fd = channel->fd();
-            channels_[fd] = channel;
+            resizeEventList(std::min(size * 2, maxEvents_));
         }
-        else // index == kAdd
+    }
+    else if (size > initEvents_ && static_cast<size_t>(numEvents) <= size / 4)
+    {
+        // 一次突发把数组撑大以后，持续空闲时逐步缩回去，把内存还给系统
+        if (++lowActivityPolls_ >= kShrinkAfterPolls)
         {
+            lowActivityPolls_ = 0;
+            resizeEventList(std::max(size / 2, initEvents_));
         }
-        channel->set_index(kAdded);  // 不存在则添加进去
-        update(EPOLL_CTL_ADD, channel);
     }
-    else // channel已经在Poller中注册过了，存在
+    else
+    {
+        lowActivityPolls_ = 0;
+    }
+}
+
+void EPollPoller::resizeEventList(size_t size)
+{
+    if (size != events_.size())
+    {
+        EventList(size).swap(events_);
+    }
+}
+
+// channel update remove => EventLoop updateChannel removeChannel => Poller updateChannel removeChannel
+// 向epoll中更新数据
+// 这里只记录到待更新列表，下一次epoll_wait之前统一调用epoll_ctl。一轮循环里先enableWriting又disableWriting，
+// 最终和内核里的一样，就不会有系统调用
+void EPollPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    LOG_DEBUG("func=%s => fd=%d events=%d index=%d\n", __FUNCTION__, channel->fd(), channel->events(), index);
+
+    if (index == kNew)
     {
         int fd = channel->fd();
-        if (channel->isNoneEvent())
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        }
-        else
-        {
-            update(EPOLL_CTL_MOD, channel);
-        }
+        channels_[fd] = channel;
+        channel->set_index(kDeleted);   // 在channels_中，还没有注册到内核
+    }
+    if (!channel->pendingUpdate())
+    {
+        channel->setPendingUpdate(true);
+        pendingUpdates_.push_back(channel);
     }
 }
 
 // 从Poller中删除channel
+// channel删除后马上会被析构、fd会被关闭，不能等到下一轮，立即从内核和待更新列表中删除
 void EPollPoller::removeChannel(Channel *channel)
 {
     int fd = channel->fd();  // 根据fd删除对应channel
     channels_.erase(fd);
 
-    LOG_INFO("func=%s => fd=%d\n", __FUNCTION__, fd);
+    LOG_DEBUG("func=%s => fd=%d\n", __FUNCTION__, fd);
 
+    if (channel->pendingUpdate())
+    {
+        channel->setPendingUpdate(false);
+        auto it = std::find(pendingUpdates_.begin(), pendingUpdates_.end(), channel);
+        if (it != pendingUpdates_.end())
+        {
+            *it = pendingUpdates_.back();   // 顺序无关，和最后一个交换后删除
+            pendingUpdates_.pop_back();
+        }
+    }
     int index = channel->index();
     if (index == kAdded)
     {
@@ -114,6 +159,37 @@ void EPollPoller::removeChannel(Channel *channel)
     channel->set_index(kNew);
 }
 
+// epoll_wait之前调用，让内核中注册的事件和每个channel最终的events()一致
+void EPollPoller::applyPendingUpdates()
+{
+    for (Channel *channel : pendingUpdates_)
+    {
+        channel->setPendingUpdate(false);
+        int index = channel->index();
+        if (channel->isNoneEvent())
+        {
+            if (index == kAdded)
+            {
+                update(EPOLL_CTL_DEL, channel);
+                channel->set_index(kDeleted);
+            }
+        }
+        else if (index == kAdded)
+        {
+            if (channel->events() != channel->registeredEvents())
+            {
+                update(EPOLL_CTL_MOD, channel);
+            }
+        }
+        else
+        {
+            update(EPOLL_CTL_ADD, channel);
+            channel->set_index(kAdded);
+        }
+    }
+    pendingUpdates_.clear();
+}
+
 // 填写活跃的连接
 // 将 epoll返回活跃的channel  返回给activeChannels
 void EPollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
@@ -143,6 +219,7 @@ void EPollPoller::update(int operation, Channel *channel)
     // 第二个参数表示操作类型，有EPOLL_CTL_ADD   EPOLL_CTL_MOD     EPOLL_CTL_DEL
     // 第三个参数表示需要监听的fd
     // 第四个参数event表示需要监听的event
+    channel->setRegisteredEvents(operation == EPOLL_CTL_DEL ? 0 : event.events);
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if (operation == EPOLL_CTL_DEL)
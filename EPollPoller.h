@@ -35,10 +35,17 @@ public:
     TimeStamp poll(int timeoutMs, channelList *activeChannels);
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
+    void setEventListLimits(int initialEvents, int maxEvents);
 
 private:
     // 对于每个epoll，需要定义其 epoll_event 数组的长度
     static const int kInitEventSize = 16;
+    static const int kMaxEventSize = 4096;   // 默认一次最多处理的事件数
+    static const int kShrinkAfterPolls = 1024;   // 连续这么多次poll都用不到数组的1/4，数组减半
+
+    void resizeEventList(size_t size);
+    void adjustEventList(int numEvents);   // 按这次poll返回的事件数扩大或者缩小事件数组
+    void applyPendingUpdates();   // 把待更新列表中的变化一次性同步到内核
 
     /**
      * fillActive 将 epoll返回的活跃channel 返回给activeChannels
@@ -69,6 +76,10 @@ private:
 
     int epollfd_;    // 代表新创建的epoll实例的文件描述符(event_create函数的返回值)
     EventList events_;   // 用于存放epoll_wait返回的所有发生的事件的文件描述符事件集合
+    size_t initEvents_;   // events_最小的大小
+    size_t maxEvents_;    // events_最大的大小，也就是一次poll最多返回的事件数
+    int lowActivityPolls_;   // 连续的低活跃poll次数
+    std::vector<Channel *> pendingUpdates_;   // 本轮循环中事件有变化的channel，每个最多出现一次
 
 };
 
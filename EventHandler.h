@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Timestamp.h"
+
+/**
+ * Channel上事件的处理者，库内部的TcpConnection、Acceptor实现这个接口
+ * Channel只保存一个EventHandler指针，分发事件时是一次虚函数调用，
+ * 不需要为每个回调保存一个std::function(每个32字节，std::bind成员函数时还要堆分配)
+ * 实现类声明为final时，在实现类内部直接调用这些函数还可以被编译器去虚化
+ * 用户代码仍然可以用Channel::setReadCallback等std::function回调
+ * */
+class EventHandler
+{
+public:
+    virtual void handleRead(Timestamp receiveTime) = 0;
+    virtual void handleWrite() {}
+    virtual void handleClose() {}
+    virtual void handleError() {}
+
+protected:
+    ~EventHandler() = default;   // 不通过EventHandler指针销毁对象
+};
@@ -7,11 +7,13 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <memory>
+#include <algorithm>
 
 #include "EventLoop.h"
 #include "Channel.h"
 #include "Poller.h"
 #include "Logger.h"
+#include "TimerQueue.h"
 
 
 // 防止一个线程创建多个EventLoop
@@ -47,13 +49,19 @@ int createEventfd()
 }
 
 EventLoop::EventLoop()
-        : looping_(false)
+        : threadId_(CurrentThread::tid())  // 创建EventLoop时候，获取当前进程的id
+        , looping_(false)
         , quit_(false)
-        , callingPendingFunctors_(false)
-        , threadId_(CurrentThread::tid())  // 创建EventLoop时候，获取当前进程的id
         , poller_(Poller::newDefaultPoller(this))
         , wakeupFd_(createEventfd())   //
         , wakeupChannel_(new Channel(this, wakeupFd_))
+        , timerQueue_(new TimerQueue(this))
+        , callingPendingFunctors_(false)
+        , lowPriorityBudget_(kDefaultLowPriorityBudget)
+        , lowBacklog_(false)
+        , busyPollNs_(0)
+        , spinning_(false)
+        , lastActiveNs_(0)
 {
     LOG_DEBUG("EventLoop created %p in thread %d\n", this, threadId_);
     if (t_loopInThisThread)
@@ -92,7 +100,16 @@ void EventLoop::loop()
     while (!quit_)
     {
         activeChannels_.clear();
-        pollRetureTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        int64_t pollStart = EventLoopMetrics::nowNanos();
+        metrics_.enterPhase(EventLoopMetrics::kPolling, pollStart);
+        pollRetureTime_ = poller_->poll(pollTimeout(pollStart), &activeChannels_);
+        int64_t handleStart = EventLoopMetrics::nowNanos();
+        if (!activeChannels_.empty())
+        {
+            lastActiveNs_ = handleStart;
+        }
+        metrics_.recordPoll(handleStart - pollStart, activeChannels_.size());
+        metrics_.enterPhase(EventLoopMetrics::kHandlingEvents, handleStart);
         for (Channel *channel : activeChannels_)
         {
             // Poller监听哪些channel发生了事件 然后上报给EventLoop 通知channel处理相应的事件
@@ -100,6 +117,7 @@ void EventLoop::loop()
             // Channel::handleEvent->Channel::handleEventWithGuard->readCallback_(receiveTime)->Acceptor::handleRead
             channel->handleEvent(pollRetureTime_);
         }
+        metrics_.recordHandleEvents(EventLoopMetrics::nowNanos() - handleStart);
         /**
          * 执行当前EventLoop事件循环需要处理的回调操作 对于线程数 >=2 的情况 IO线程 mainloop(mainReactor) 主要工作：
          * accept接收连接 => 将accept返回的connfd打包为Channel => TcpServer::newConnection通过轮询将TcpConnection对象分配给subloop处理
@@ -109,6 +127,7 @@ void EventLoop::loop()
         doPendingFunctors();
     }
     LOG_INFO("EventLoop %p stop looping.\n", this);
+    metrics_.enterPhase(EventLoopMetrics::kIdle, EventLoopMetrics::nowNanos());
     looping_ = false;
 }
 
@@ -132,8 +151,35 @@ void EventLoop::quit()
     }
 }
 
+// 忙轮询时决定这次poll是空转(超时为0)还是阻塞
+int EventLoop::pollTimeout(int64_t now)
+{
+    if (lowBacklog_)
+    {
+        return 0;   // 低优先级的回调还没执行完，只看一眼有没有事件
+    }
+    int64_t spinNs = busyPollNs_.load(std::memory_order_relaxed);
+    if (spinNs > 0 && now - lastActiveNs_ < spinNs)
+    {
+        spinning_ = true;
+        return 0;
+    }
+    if (!spinning_)
+    {
+        return kPollTimeMs;   // 上一轮没有空转，queueInLoop都会唤醒
+    }
+    /**
+     * 准备阻塞(空转时间到了，或者空转中途被setBusyPoll关掉)：先清spinning_再检查队列。
+     * queueInLoop是先入队再读spinning_，所以要么这里看到新入队的回调不阻塞，
+     * 要么queueInLoop看到spinning_为false去唤醒，不会丢唤醒
+     * */
+    spinning_ = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    return pendingFunctors_.empty() && lowPendingFunctors_.empty() ? kPollTimeMs : 0;
+}
+
 // 在当前loop中执行cb
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Functor cb, Priority priority)
 {
     if (isInLoopThread()) // 当前EventLoop中执行回调,单reactor
     {
@@ -141,16 +187,23 @@ void EventLoop::runInLoop(Functor cb)
     }
     else // 在非当前EventLoop线程中执行cb，就需要唤醒EventLoop所在线程执行cb
     {
-        queueInLoop(cb);// 唤醒并执行cb
+        queueInLoop(std::move(cb), priority);// 唤醒并执行cb
     }
 }
 
 // 把cb放入队列中 唤醒loop所在的线程执行cb
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Functor cb, Priority priority)
 {
     {  // 指定临界区
         std::unique_lock<std::mutex> lock(mutex_);  // 临界区加锁
-        pendingFunctors_.emplace_back(cb);
+        if (priority == kLowPriority)
+        {
+            lowPendingFunctors_.emplace_back(std::move(cb));
+        }
+        else
+        {
+            pendingFunctors_.emplace_back(std::move(cb));
+        }
     }
 
     /**
@@ -161,12 +214,30 @@ void EventLoop::queueInLoop(Functor cb)
     // 若此时新加了回调
     // 新加的5个回调加进来了，此时也正在执行dopendingfunctors
     // 那么就唤醒线程，解除阻塞，写入唤醒的8个字节，再写入新加的5个线程
-    if (!isInLoopThread() || callingPendingFunctors_)
+    // 忙轮询空转时loop马上就会执行到doPendingFunctors，不需要写eventfd
+    if ((!isInLoopThread() && !spinning_) || callingPendingFunctors_)
     {
         wakeup(); // 唤醒loop所在线程
     }
 }
 
+TimerId EventLoop::runAfter(int delayMs, functor cb)
+{
+    int64_t when = Timer::nowMicros() + static_cast<int64_t>(delayMs) * 1000;
+    return timerQueue_->addTimer(std::move(cb), when, 0);
+}
+
+TimerId EventLoop::runEvery(int intervalMs, functor cb)
+{
+    int64_t interval = static_cast<int64_t>(intervalMs) * 1000;
+    return timerQueue_->addTimer(std::move(cb), Timer::nowMicros() + interval, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
 void EventLoop::handleRead()
 {
     uint64_t one = 1;  // 一个64位，8字节
@@ -199,6 +270,11 @@ void EventLoop::removeChannel(Channel *channel)
     poller_->removeChannel(channel);
 }
 
+void EventLoop::setPollerEventLimits(int initialEvents, int maxEvents)
+{
+    poller_->setEventListLimits(initialEvents, maxEvents);
+}
+
 bool EventLoop::hasChannel(Channel *channel)
 {
     return poller_->hasChannel(channel);
@@ -210,9 +286,21 @@ void EventLoop::doPendingFunctors()
 {
     std::vector<Functor> functors;
     callingPendingFunctors_ = true;
+    int64_t start = EventLoopMetrics::nowNanos();
+    metrics_.enterPhase(EventLoopMetrics::kPendingFunctors, start);
 
+    std::vector<Functor> lowFunctors;
     {
         std::unique_lock<std::mutex> lock(mutex_);
+        // 低优先级的每轮最多取lowPriorityBudget个，先进先出
+        size_t n = std::min(lowPendingFunctors_.size(), lowPriorityBudget_.load(std::memory_order_relaxed));
+        lowFunctors.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            lowFunctors.push_back(std::move(lowPendingFunctors_.front()));
+            lowPendingFunctors_.pop_front();
+        }
+        lowBacklog_ = !lowPendingFunctors_.empty();
         functors.swap(pendingFunctors_); // 交换的方式减少了锁的临界区范围 提升效率 同时避免了死锁 如果执行functor()在临界区内 且functor()中调用queueInLoop()就会产生死锁
     }
     // swap直接换出，减少了锁的临界区范围
@@ -229,7 +317,18 @@ void EventLoop::doPendingFunctors()
     {
         functor(); // 执行当前loop需要执行的回调操作
     }
+    // 高优先级的都执行完才轮到低优先级的
+    for (const Functor &functor : lowFunctors)
+    {
+        functor();
+    }
 
+    int64_t end = EventLoopMetrics::nowNanos();
+    metrics_.recordPendingFunctors(end - start, functors.size() + lowFunctors.size());
+    if (!functors.empty() || !lowFunctors.empty())
+    {
+        lastActiveNs_ = end;
+    }
     callingPendingFunctors_ = false;
 }
 
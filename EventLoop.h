@@ -9,13 +9,17 @@
 #include <atomic>
 #include <mutex>
 #include <memory>
+#include <deque>
 
 #include "TimeStamp.h"
 #include "nonCopyable.h"
 #include "currentThread.h"
+#include "Timer.h"
+#include "EventLoopMetrics.h"
 
 class Channel;
 class Poller;
+class TimerQueue;
 
 class EventLoop:nonCopyable {  // 继承了nonCopyable，防止拷贝
 public:
@@ -34,13 +38,56 @@ public:
     void loop();
     void quit_loop();
 
+    /**
+     * 回调的优先级
+     * kHighPriority(默认)：连接建立、销毁、发送这类控制面的回调，下一轮循环一定全部执行
+     * kLowPriority：广播这类数量大、晚一点执行也可以的回调，每轮循环在高优先级的之后最多执行lowPriorityBudget个，
+     *               剩下的留给之后的循环(期间poll不阻塞)，大量的低优先级回调不会推迟控制面的回调
+     * */
+    enum Priority
+    {
+        kHighPriority,
+        kLowPriority,
+    };
+    static const size_t kDefaultLowPriorityBudget = 256;
+
     /**
      * 在当前loop中执行callback
      * callback 丢到队列中
+     * 在loop线程中调用时不论优先级都直接执行
      * */
-    void runInLoop(functor cb);
+    void runInLoop(functor cb, Priority priority = kHighPriority);
     // callback 放入到队列中，唤醒线程开始执行cb
-    void queueInLoop(functor cb);
+    void queueInLoop(functor cb, Priority priority = kHighPriority);
+
+    // 每轮循环最多执行的低优先级回调数，至少为1，可以在任意线程调用
+    void setLowPriorityBudget(size_t budget) { lowPriorityBudget_.store(budget > 0 ? budget : 1, std::memory_order_relaxed); }
+    size_t lowPriorityBudget() const { return lowPriorityBudget_.load(std::memory_order_relaxed); }
+
+    /**
+     * 定时器，可以跨线程调用，回调在当前loop中执行
+     * runAfter  delayMs毫秒后执行一次cb
+     * runEvery  每隔intervalMs毫秒执行一次cb
+     * */
+    TimerId runAfter(int delayMs, functor cb);
+    TimerId runEvery(int intervalMs, functor cb);
+    void cancel(TimerId timerId);
+
+    /**
+     * 给协程用：co_await loop->sleep(ms)，ms毫秒后由这个loop的定时器恢复协程，不阻塞loop
+     * 只是一个awaiter，本身不依赖C++20，协程的其他部分见Coroutine.h
+     * loop退出时还没到期的协程不会再恢复
+     * */
+    struct SleepAwaiter
+    {
+        EventLoop *loop;
+        int delayMs;
+        bool await_ready() const { return delayMs <= 0; }
+        template <typename Handle>
+        void await_suspend(Handle handle) { loop->runAfter(delayMs, [handle]() mutable { handle.resume(); }); }
+        void await_resume() const {}
+    };
+    SleepAwaiter sleep(int delayMs) { return SleepAwaiter{this, delayMs}; }
 
     /**
      * muduo 是个多 reactor 网络库， 也支持单reactor
@@ -63,6 +110,23 @@ public:
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
 
+    /**
+     * 运行时指标：poll等待时间、事件处理时间、pendingFunctors执行时间及批量大小
+     * 可以在任意线程调用，用于发现卡住的subloop
+     * */
+    EventLoopMetrics::Snapshot metrics() const { return metrics_.snapshot(); }
+
+    /**
+     * 忙轮询：最近一次有事件或回调之后的spinUs微秒内，用超时为0的epoll_wait空转，超过之后才阻塞
+     * 唤醒延迟从一次线程调度(几十微秒)降到个位数微秒，代价是空转期间占满一个核，适合绑核的loop
+     * 空转期间其他线程queueInLoop不再写eventfd唤醒。0表示关闭(默认)，可以在任意线程调用
+     * */
+    void setBusyPoll(int spinUs) { busyPollNs_.store(static_cast<int64_t>(spinUs) * 1000, std::memory_order_relaxed); }
+    int busyPollUs() const { return static_cast<int>(busyPollNs_.load(std::memory_order_relaxed) / 1000); }
+
+    // 见Poller::setEventListLimits，需要在loop线程中或者loop开始之前调用
+    void setPollerEventLimits(int initialEvents, int maxEvents);
+
     /**
      * 判断当前EventLoop是否在自己线程
      */
@@ -84,17 +148,29 @@ private:
     int wakeupFd_; // loop选择一个新用户的Channel时，会通过轮询算法选择一个subplot，通过该成员唤醒subloop处理channel
     std::unique_ptr<Channel> wakeupChannel_;  // 指向唤醒的channel
 
+    std::unique_ptr<TimerQueue> timerQueue_;  // 定时器队列，timerfd同样通过Channel注册到poller_上
+
     // 记录所有的活跃channel
     using channelList = std::vector<Channel*>;
     channelList activeChannelList_;  // poller检测到当前有事件发生的所有channel
 
     std::atomic_bool callingPendingFunctors_;  // 标识当前loop是否有需要执行的回调操作
     std::vector<functor> pendingFunctors; // 存储loop的所有回调操作
+    std::deque<functor> lowPendingFunctors_;  // 低优先级的回调，和pendingFunctors共用mutex_
+    std::atomic<size_t> lowPriorityBudget_;  // 每轮循环最多执行的低优先级回调数
+    bool lowBacklog_;  // 上一轮执行完后低优先级队列中还有回调，只在loop线程中访问
 
     std::mutex mutex_;  // 互斥锁
 
+    EventLoopMetrics metrics_;  // 只在loop线程中写入
+
+    std::atomic<int64_t> busyPollNs_;  // 空转时长，0表示不空转
+    std::atomic_bool spinning_;  // 正在空转，queueInLoop不需要唤醒
+    int64_t lastActiveNs_;  // 最近一次处理事件或回调的时间，只在loop线程中访问
+
 
     void doPendingFunctors();  // 执行存储的回调函数
+    int pollTimeout(int64_t now);  // 这次poll的超时时间，忙轮询空转时为0
 
     // 给eventfd返回的文件描述符wakeupFd_绑定的事件回调 当wakeup()时 即有事件发生时 调用handleRead()读wakeupFd_的8字节 同时唤醒阻塞的epoll_wait
     // handleRead是wakeup fd所绑定的一个回调
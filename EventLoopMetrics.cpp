@@ -0,0 +1,161 @@
+#include <time.h>
+
+#include "EventLoopMetrics.h"
+
+Histogram::Histogram()
+{
+    reset();
+}
+
+// 值v所在的桶: 最高位为e，再取最高位后面的kSubBucketBits位作为子桶下标
+int Histogram::bucketIndex(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(kSubBuckets))   // 小于kSubBuckets的值，每个值一个桶
+    {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMaxExponent)
+    {
+        return kNumBuckets - 1;
+    }
+    int sub = static_cast<int>((value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(int index)
+{
+    if (index < kSubBuckets)
+    {
+        return static_cast<uint64_t>(index);
+    }
+    int exponent = index / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+    uint64_t width = 1ULL << (exponent - kSubBucketBits);
+    return (1ULL << exponent) + (sub + 1) * width - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    increment(count_, 1);
+    increment(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(value, std::memory_order_relaxed);
+    }
+    increment(buckets_[bucketIndex(value)], 1);
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snap;
+    snap.count = count_.load(std::memory_order_relaxed);
+    snap.sum = sum_.load(std::memory_order_relaxed);
+    snap.max = max_.load(std::memory_order_relaxed);
+    snap.buckets.resize(kNumBuckets);
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+void Histogram::reset()
+{
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < kNumBuckets; ++i)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Histogram::Snapshot::percentile(double p) const
+{
+    // 各个桶是分别读取的，总数以桶为准
+    uint64_t total = 0;
+    for (uint64_t n : buckets)
+    {
+        total += n;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(total * p / 100.0);
+    if (target >= total)
+    {
+        target = total - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen > target)
+        {
+            uint64_t upper = Histogram::bucketUpperBound(static_cast<int>(i));
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+EventLoopMetrics::EventLoopMetrics()
+    : iterations_(0)
+    , events_(0)
+    , functors_(0)
+    , phase_(kIdle)
+    , phaseStartNs_(0)
+{
+}
+
+int64_t EventLoopMetrics::nowNanos()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+void EventLoopMetrics::enterPhase(Phase phase, int64_t nowNs)
+{
+    phaseStartNs_.store(nowNs, std::memory_order_relaxed);
+    phase_.store(phase, std::memory_order_release);
+}
+
+void EventLoopMetrics::recordPoll(int64_t waitNs, size_t activeChannels)
+{
+    iterations_.store(iterations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    events_.store(events_.load(std::memory_order_relaxed) + activeChannels, std::memory_order_relaxed);
+    pollWaitNs_.record(static_cast<uint64_t>(waitNs));
+    activeChannels_.record(activeChannels);
+}
+
+void EventLoopMetrics::recordHandleEvents(int64_t elapsedNs)
+{
+    handleEventNs_.record(static_cast<uint64_t>(elapsedNs));
+}
+
+void EventLoopMetrics::recordPendingFunctors(int64_t elapsedNs, size_t functors)
+{
+    functors_.store(functors_.load(std::memory_order_relaxed) + functors, std::memory_order_relaxed);
+    pendingFunctorNs_.record(static_cast<uint64_t>(elapsedNs));
+    functorBatch_.record(functors);
+}
+
+EventLoopMetrics::Snapshot EventLoopMetrics::snapshot() const
+{
+    Snapshot snap;
+    snap.phase = static_cast<Phase>(phase_.load(std::memory_order_acquire));
+    int64_t start = phaseStartNs_.load(std::memory_order_relaxed);
+    snap.phaseDurationNs = snap.phase == kIdle ? 0 : nowNanos() - start;
+    snap.iterations = iterations_.load(std::memory_order_relaxed);
+    snap.events = events_.load(std::memory_order_relaxed);
+    snap.functors = functors_.load(std::memory_order_relaxed);
+    snap.pollWaitNs = pollWaitNs_.snapshot();
+    snap.handleEventNs = handleEventNs_.snapshot();
+    snap.pendingFunctorNs = pendingFunctorNs_.snapshot();
+    snap.activeChannels = activeChannels_.snapshot();
+    snap.functorBatch = functorBatch_.snapshot();
+    return snap;
+}
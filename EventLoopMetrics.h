@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nonCopyable.h"
+
+/**
+ * HDR风格的直方图(对数-线性分桶)
+ * 每个2的幂区间[2^e, 2^(e+1))再均分为kSubBuckets个子桶，相对误差不超过 1/kSubBuckets
+ * 只有loop线程写入，写入时不需要原子的读-改-写，只用relaxed的load/store，其他线程可以随时读取
+ * */
+class Histogram : nonCopyable
+{
+public:
+    static const int kSubBucketBits = 5;
+    static const int kSubBuckets = 1 << kSubBucketBits;   // 每个2的幂区间的子桶数，相对误差不超过1/32
+    static const int kMaxExponent = 40;                    // 超过2^40的值都记在最后一个桶
+    // [0, kSubBuckets)每个值一个桶，之后指数kSubBucketBits到kMaxExponent每个kSubBuckets个桶
+    static const int kNumBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    // 直方图在某一时刻的拷贝
+    struct Snapshot
+    {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets;
+
+        double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+        // 返回第p百分位(0~100)所在桶的上界
+        uint64_t percentile(double p) const;
+    };
+
+    Histogram();
+
+    void record(uint64_t value);   // 只能在loop线程中调用
+    Snapshot snapshot() const;     // 任意线程都可以调用
+    void reset();                  // 只能在loop线程中调用
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    static void increment(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+};
+
+/**
+ * 每个EventLoop的运行时指标
+ * loop线程在每次循环的各个阶段记录耗时和批量大小，其他线程通过snapshot()随时获取
+ * 当前所处阶段和进入该阶段的时间也会被记录，某个阶段停留时间过长，说明这个subloop卡住了
+ * */
+class EventLoopMetrics : nonCopyable
+{
+public:
+    enum Phase
+    {
+        kIdle,           // 还未开始loop或者已经退出
+        kPolling,        // 阻塞在poller_->poll
+        kHandlingEvents, // 正在执行channel->handleEvent
+        kPendingFunctors // 正在执行doPendingFunctors
+    };
+
+    struct Snapshot
+    {
+        uint64_t iterations = 0;       // loop循环次数
+        uint64_t events = 0;           // 处理的活跃channel总数
+        uint64_t functors = 0;         // 执行的pending functor总数
+        Phase phase = kIdle;           // 当前阶段
+        int64_t phaseDurationNs = 0;   // 已经在当前阶段停留的时间
+
+        Histogram::Snapshot pollWaitNs;         // 每次poll的等待时间
+        Histogram::Snapshot handleEventNs;      // 每次循环中处理所有活跃channel的时间
+        Histogram::Snapshot pendingFunctorNs;   // 每次doPendingFunctors的时间
+        Histogram::Snapshot activeChannels;     // 每次poll返回的活跃channel数
+        Histogram::Snapshot functorBatch;       // 每次doPendingFunctors执行的functor数
+    };
+
+    EventLoopMetrics();
+
+    // 以下由loop线程调用
+    void enterPhase(Phase phase, int64_t nowNs);
+    void recordPoll(int64_t waitNs, size_t activeChannels);
+    void recordHandleEvents(int64_t elapsedNs);
+    void recordPendingFunctors(int64_t elapsedNs, size_t functors);
+
+    Snapshot snapshot() const;   // 任意线程都可以调用
+
+    // 单调时钟，单位纳秒
+    static int64_t nowNanos();
+
+private:
+    std::atomic<uint64_t> iterations_;
+    std::atomic<uint64_t> events_;
+    std::atomic<uint64_t> functors_;
+    std::atomic<int> phase_;
+    std::atomic<int64_t> phaseStartNs_;
+
+    Histogram pollWaitNs_;
+    Histogram handleEventNs_;
+    Histogram pendingFunctorNs_;
+    Histogram activeChannels_;
+    Histogram functorBatch_;
+};
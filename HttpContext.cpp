@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <stdlib.h>
+
+#include "HttpContext.h"
+#include "Buffer.h"
+
+HttpContext::HttpContext()
+    : state_(kExpectRequestLine)
+    , parsed_(0)
+    , scanned_(0)
+    , bodyLength_(0)
+    , streaming_(false)
+    , closing_(false)
+{
+}
+
+void HttpContext::reset()
+{
+    state_ = kExpectRequestLine;
+    parsed_ = 0;
+    scanned_ = 0;
+    bodyLength_ = 0;
+    request_.reset();
+}
+
+HttpContext::ParseResult HttpContext::parse(const Buffer *buf, Timestamp receiveTime)
+{
+    // 偏移都是相对于peek()的，Buffer扩容或者内容前移都不影响已经解析的结果
+    const char *base = buf->peek();
+    const size_t readable = buf->readableBytes();
+
+    while (state_ != kGotAll)
+    {
+        if (state_ == kExpectBody)
+        {
+            if (readable - parsed_ < bodyLength_)
+            {
+                return kIncomplete;
+            }
+            request_.body_.offset = static_cast<uint32_t>(parsed_);
+            request_.body_.length = static_cast<uint32_t>(bodyLength_);
+            parsed_ += bodyLength_;
+            state_ = kGotAll;
+            break;
+        }
+
+        // 请求行和头部都是按行解析的
+        const char *lineBegin = base + parsed_;
+        const char *crlf = buf->findCRLF(base + scanned_);
+        if (crlf == nullptr)
+        {
+            // 最后一个字节可能是'\r'，下次从它开始找
+            scanned_ = std::max(parsed_, readable > 0 ? readable - 1 : 0);
+            return readable > kMaxHeaderBytes ? kError : kIncomplete;
+        }
+
+        bool ok = true;
+        if (state_ == kExpectRequestLine)
+        {
+            if (crlf != lineBegin)   // 忽略请求之间多余的空行
+            {
+                ok = processRequestLine(base, lineBegin, crlf);
+                state_ = kExpectHeaders;
+            }
+        }
+        else if (crlf == lineBegin)   // 空行，头部结束
+        {
+            ok = processHeadersEnd(base);
+        }
+        else
+        {
+            ok = processHeader(base, lineBegin, crlf);
+        }
+        if (!ok)
+        {
+            return kError;
+        }
+
+        parsed_ = crlf + 2 - base;
+        scanned_ = parsed_;
+        if (state_ != kExpectBody && parsed_ > kMaxHeaderBytes)
+        {
+            return kError;
+        }
+    }
+
+    request_.base_ = base;
+    request_.receiveTime_ = receiveTime;
+    return kComplete;
+}
+
+// GET /index.html?a=1 HTTP/1.1
+bool HttpContext::processRequestLine(const char *base, const char *begin, const char *end)
+{
+    const char *space = std::find(begin, end, ' ');
+    if (space == end)
+    {
+        return false;
+    }
+
+    StringPiece method(begin, space - begin);
+    if (method == "GET") request_.method_ = HttpRequest::kGet;
+    else if (method == "POST") request_.method_ = HttpRequest::kPost;
+    else if (method == "HEAD") request_.method_ = HttpRequest::kHead;
+    else if (method == "PUT") request_.method_ = HttpRequest::kPut;
+    else if (method == "DELETE") request_.method_ = HttpRequest::kDelete;
+    else if (method == "OPTIONS") request_.method_ = HttpRequest::kOptions;
+    else return false;
+
+    const char *start = space + 1;
+    space = std::find(start, end, ' ');
+    if (space == end)
+    {
+        return false;
+    }
+    const char *question = std::find(start, space, '?');
+    request_.path_.offset = static_cast<uint32_t>(start - base);
+    request_.path_.length = static_cast<uint32_t>(question - start);
+    if (question != space)
+    {
+        request_.query_.offset = static_cast<uint32_t>(question + 1 - base);
+        request_.query_.length = static_cast<uint32_t>(space - question - 1);
+    }
+
+    StringPiece version(space + 1, end - space - 1);
+    if (version == "HTTP/1.1") request_.version_ = HttpRequest::kHttp11;
+    else if (version == "HTTP/1.0") request_.version_ = HttpRequest::kHttp10;
+    else return false;
+    return true;
+}
+
+// Host: 127.0.0.1:8000
+bool HttpContext::processHeader(const char *base, const char *begin, const char *end)
+{
+    const char *colon = std::find(begin, end, ':');
+    if (colon == end || colon == begin)
+    {
+        return false;
+    }
+    const char *valueBegin = colon + 1;
+    while (valueBegin < end && (*valueBegin == ' ' || *valueBegin == '\t'))
+    {
+        ++valueBegin;
+    }
+    const char *valueEnd = end;
+    while (valueEnd > valueBegin && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t'))
+    {
+        --valueEnd;
+    }
+
+    HttpRequest::Header header;
+    header.name.offset = static_cast<uint32_t>(begin - base);
+    header.name.length = static_cast<uint32_t>(colon - begin);
+    header.value.offset = static_cast<uint32_t>(valueBegin - base);
+    header.value.length = static_cast<uint32_t>(valueEnd - valueBegin);
+    request_.headers_.push_back(header);
+    return true;
+}
+
+bool HttpContext::processHeadersEnd(const char *base)
+{
+    request_.base_ = base;
+    if (!request_.getHeader("Transfer-Encoding").empty())   // 不支持chunked编码的请求体
+    {
+        return false;
+    }
+
+    bodyLength_ = 0;
+    StringPiece contentLength = request_.getHeader("Content-Length");
+    if (!contentLength.empty())
+    {
+        char *endptr = nullptr;
+        std::string value = contentLength.as_string();
+        unsigned long long length = ::strtoull(value.c_str(), &endptr, 10);
+        if (*endptr != '\0' || length > kMaxBodyBytes)
+        {
+            return false;
+        }
+        bodyLength_ = static_cast<size_t>(length);
+    }
+    state_ = bodyLength_ > 0 ? kExpectBody : kGotAll;
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "HttpRequest.h"
+
+class Buffer;
+
+/**
+ * 每个连接一个的http请求解析器
+ * 增量解析：数据不完整时记住已经解析到的位置，下一次handleRead到来时从该位置继续，
+ * 不会从头重新扫描；解析过程中不修改Buffer，也不拷贝数据
+ * 一个请求解析完成后，由调用方处理完再retrieve(requestLength())并reset()，接着解析流水线上的下一个请求
+ * */
+class HttpContext : noncopyable
+{
+public:
+    enum ParseResult
+    {
+        kIncomplete,   // 数据不够，等待更多数据
+        kComplete,     // 解析出一个完整的请求
+        kError         // 请求格式错误或者超出限制
+    };
+
+    static const size_t kMaxHeaderBytes = 64 * 1024;          // 请求行+头部的最大长度
+    static const size_t kMaxBodyBytes = 64 * 1024 * 1024;     // body的最大长度
+
+    HttpContext();
+
+    // 从buf->peek()开始增量解析
+    ParseResult parse(const Buffer *buf, Timestamp receiveTime);
+
+    // 解析完成的请求，只在parse返回kComplete之后、buf被retrieve之前有效
+    const HttpRequest &request() const { return request_; }
+    // 整个请求(包括body)在buf中占用的长度
+    size_t requestLength() const { return parsed_; }
+
+    void reset();
+
+    // 正在发送流式chunked响应，此时暂停解析流水线上后续的请求，保证响应的顺序
+    bool streaming() const { return streaming_; }
+    void setStreaming(bool on) { streaming_ = on; }
+    // 当前响应发送完后需要关闭连接
+    bool closing() const { return closing_; }
+    void setClosing(bool on) { closing_ = on; }
+
+private:
+    enum ParseState
+    {
+        kExpectRequestLine,
+        kExpectHeaders,
+        kExpectBody,
+        kGotAll
+    };
+
+    bool processRequestLine(const char *base, const char *begin, const char *end);
+    bool processHeader(const char *base, const char *begin, const char *end);
+    bool processHeadersEnd(const char *base);   // 头部结束，根据Content-Length决定是否有body
+
+    ParseState state_;
+    size_t parsed_;     // 已经完整解析的字节数，下一行从这里开始
+    size_t scanned_;    // 查找CRLF已经扫描到的位置，数据不完整时下一次从这里继续查找
+    size_t bodyLength_;
+    HttpRequest request_;
+
+    bool streaming_;
+    bool closing_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+/**
+ * http请求
+ * 不拷贝任何数据，所有字段都记录为相对于请求起始位置(Buffer::peek())的偏移，
+ * 通过StringPiece返回，因此只在HttpCallback执行期间有效
+ * */
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid, kGet, kPost, kHead, kPut, kDelete, kOptions
+    };
+    enum Version
+    {
+        kUnknown, kHttp10, kHttp11
+    };
+
+    HttpRequest()
+        : base_(nullptr)
+        , method_(kInvalid)
+        , version_(kUnknown)
+    {
+    }
+
+    Method method() const { return method_; }
+    Version version() const { return version_; }
+    const char *methodString() const
+    {
+        switch (method_)
+        {
+            case kGet: return "GET";
+            case kPost: return "POST";
+            case kHead: return "HEAD";
+            case kPut: return "PUT";
+            case kDelete: return "DELETE";
+            case kOptions: return "OPTIONS";
+            default: return "UNKNOWN";
+        }
+    }
+
+    StringPiece path() const { return piece(path_); }
+    StringPiece query() const { return piece(query_); }   // 不包括'?'
+    StringPiece body() const { return piece(body_); }
+
+    // 按字段名查找头部，大小写不敏感，找不到返回空
+    StringPiece getHeader(const StringPiece &field) const
+    {
+        for (const Header &header : headers_)
+        {
+            if (piece(header.name).equalsIgnoreCase(field))
+            {
+                return piece(header.value);
+            }
+        }
+        return StringPiece();
+    }
+    size_t headerCount() const { return headers_.size(); }
+    StringPiece headerName(size_t i) const { return piece(headers_[i].name); }
+    StringPiece headerValue(size_t i) const { return piece(headers_[i].value); }
+
+    Timestamp receiveTime() const { return receiveTime_; }
+
+private:
+    friend class HttpContext;
+
+    // 相对于请求起始位置的偏移和长度
+    struct Range
+    {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+    struct Header
+    {
+        Range name;
+        Range value;
+    };
+
+    StringPiece piece(const Range &r) const { return StringPiece(base_ + r.offset, r.length); }
+
+    // 清空字段，headers_保留容量，下一个请求不用重新分配
+    void reset()
+    {
+        base_ = nullptr;
+        method_ = kInvalid;
+        version_ = kUnknown;
+        path_ = Range();
+        query_ = Range();
+        body_ = Range();
+        headers_.clear();
+    }
+
+    const char *base_;   // 请求的起始位置，只在请求解析完成后、retrieve之前设置
+    Method method_;
+    Version version_;
+    Range path_;
+    Range query_;
+    Range body_;
+    std::vector<Header> headers_;
+    Timestamp receiveTime_;
+};
@@ -0,0 +1,84 @@
+#include <stdio.h>
+
+#include "HttpResponse.h"
+#include "Buffer.h"
+
+void HttpResponse::appendToBuffer(Buffer *output) const
+{
+    char buf[64];
+    int n = snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
+    output->append(buf, n);
+    output->append(statusMessage_);
+    output->append("\r\n", 2);
+
+    if (chunked_)
+    {
+        output->append("Transfer-Encoding: chunked\r\n", 28);
+    }
+    else
+    {
+        n = snprintf(buf, sizeof buf, "Content-Length: %zu\r\n", body_.size());
+        output->append(buf, n);
+    }
+
+    if (closeConnection_)
+    {
+        output->append("Connection: close\r\n", 19);
+    }
+    else
+    {
+        output->append("Connection: Keep-Alive\r\n", 24);
+    }
+
+    for (const auto &header : headers_)
+    {
+        output->append(header.first);
+        output->append(": ", 2);
+        output->append(header.second);
+        output->append("\r\n", 2);
+    }
+    output->append("\r\n", 2);
+
+    if (headOnly_)
+    {
+        return;
+    }
+
+    if (!chunked_)
+    {
+        output->append(body_);
+        return;
+    }
+
+    // 长度为0的chunk表示结束，所以空的body和chunk都不发送
+    if (!body_.empty())
+    {
+        appendChunk(output, body_.data(), body_.size());
+    }
+    for (const std::string &chunk : chunks_)
+    {
+        if (!chunk.empty())
+        {
+            appendChunk(output, chunk.data(), chunk.size());
+        }
+    }
+    if (!streaming_)
+    {
+        appendLastChunk(output);
+    }
+}
+
+// 十六进制长度\r\n数据\r\n
+void HttpResponse::appendChunk(Buffer *output, const char *data, size_t len)
+{
+    char buf[32];
+    int n = snprintf(buf, sizeof buf, "%zx\r\n", len);
+    output->append(buf, n);
+    output->append(data, len);
+    output->append("\r\n", 2);
+}
+
+void HttpResponse::appendLastChunk(Buffer *output)
+{
+    output->append("0\r\n\r\n", 5);
+}
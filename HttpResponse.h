@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+class Buffer;
+
+/**
+ * http响应
+ * 由HttpCallback填写，HttpServer再把它直接序列化到发送用的Buffer里
+ * 普通响应使用Content-Length；setChunked后使用Transfer-Encoding: chunked，
+ * 如果还setStreaming(需要StreamingHttpCallback拿到连接)，回调返回后只发送头部和已添加的chunk，
+ * 后续的chunk通过HttpServer::sendChunk发送，最后调用HttpServer::finishChunked结束
+ * */
+class HttpResponse
+{
+public:
+    enum HttpStatusCode
+    {
+        kUnknown,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k400BadRequest = 400,
+        k404NotFound = 404,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+    };
+
+    explicit HttpResponse(bool close)
+        : statusCode_(kUnknown)
+        , closeConnection_(close)
+        , chunked_(false)
+        , streaming_(false)
+        , headOnly_(false)
+    {
+    }
+
+    void setStatusCode(HttpStatusCode code) { statusCode_ = code; }
+    void setStatusMessage(const std::string &message) { statusMessage_ = message; }
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const std::string &contentType) { addHeader("Content-Type", contentType); }
+    void addHeader(const std::string &key, const std::string &value) { headers_.emplace_back(key, value); }
+
+    void setBody(const std::string &body) { body_ = body; }
+    void setBody(std::string &&body) { body_ = std::move(body); }
+
+    // chunked响应，body作为第一个chunk
+    void setChunked(bool on) { chunked_ = on; }
+    bool chunked() const { return chunked_; }
+    void addChunk(const std::string &chunk) { chunks_.push_back(chunk); }
+    // 回调返回后响应还未结束，需要之后调用HttpServer::finishChunked
+    void setStreaming(bool on) { streaming_ = on; if (on) chunked_ = true; }
+    bool streaming() const { return streaming_; }
+
+    // HEAD请求只发送头部
+    void setHeadOnly(bool on) { headOnly_ = on; }
+
+    void appendToBuffer(Buffer *output) const;
+
+    // chunked编码的辅助函数
+    static void appendChunk(Buffer *output, const char *data, size_t len);
+    static void appendLastChunk(Buffer *output);
+
+private:
+    HttpStatusCode statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_;
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string body_;
+    std::vector<std::string> chunks_;
+    bool chunked_;
+    bool streaming_;
+    bool headOnly_;
+};
@@ -0,0 +1,153 @@
+#include "HttpServer.h"
+#include "HttpContext.h"
+#include "Logger.h"
+
+// 默认的回调，所有请求都返回404
+static void defaultHttpCallback(const TcpConnectionPtr &, const HttpRequest &, HttpResponse *resp)
+{
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
+    resp->setCloseConnection(true);
+}
+
+static const char kBadRequest[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const std::string &name,
+                       TcpServer::Option option)
+    : server_(loop, listenAddr, name, option)
+    , httpCallback_(defaultHttpCallback)
+{
+    server_.setConnectionCallback(
+        std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(
+        std::bind(&HttpServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void HttpServer::setHttpCallback(const HttpCallback &cb)
+{
+    httpCallback_ = [cb](const TcpConnectionPtr &, const HttpRequest &req, HttpResponse *resp) {
+        cb(req, resp);
+        if (resp->streaming())
+        {
+            // 没有连接就没法继续发送chunk，直接结束响应，否则这个连接会一直停在流式响应上
+            LOG_ERROR("HttpServer: streaming response requires a StreamingHttpCallback\n");
+            resp->setStreaming(false);
+        }
+    };
+}
+
+void HttpServer::start()
+{
+    LOG_INFO("HttpServer starts listening\n");
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setContext(std::make_shared<HttpContext>());   // 每个连接一个解析器
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    HttpContext *context = static_cast<HttpContext *>(conn->getContext().get());
+    processRequests(conn, context, buf, receiveTime);
+}
+
+void HttpServer::processRequests(const TcpConnectionPtr &conn, HttpContext *context, Buffer *buf, Timestamp receiveTime)
+{
+    Buffer output;   // 这一批请求的所有响应
+
+    // 正在发送流式响应或者已经决定关闭连接时，后面的请求先留在buf里
+    while (!context->streaming() && !context->closing())
+    {
+        HttpContext::ParseResult result = context->parse(buf, receiveTime);
+        if (result == HttpContext::kIncomplete)
+        {
+            break;
+        }
+        if (result == HttpContext::kError)
+        {
+            output.append(kBadRequest, sizeof(kBadRequest) - 1);
+            buf->retrieveAll();
+            context->setClosing(true);
+            break;
+        }
+
+        const HttpRequest &req = context->request();
+        // http/1.1默认长连接，http/1.0默认短连接
+        StringPiece connection = req.getHeader("Connection");
+        bool close = connection.equalsIgnoreCase("close") ||
+            (req.version() == HttpRequest::kHttp10 && !connection.equalsIgnoreCase("Keep-Alive"));
+
+        HttpResponse response(close);
+        response.setHeadOnly(req.method() == HttpRequest::kHead);
+        httpCallback_(conn, req, &response);
+        response.appendToBuffer(&output);
+        // HEAD请求只有头部，回调之后发来的chunk和结束标记都丢弃
+        bool streaming = response.streaming() && req.method() != HttpRequest::kHead;
+
+        // 请求处理完之后才能retrieve，req中的StringPiece都指向buf
+        buf->retrieve(context->requestLength());
+        context->reset();
+
+        context->setStreaming(streaming);
+        context->setClosing(response.closeConnection());
+    }
+
+    if (output.readableBytes() > 0)
+    {
+        conn->send(&output);
+    }
+    if (context->closing() && !context->streaming())
+    {
+        conn->shutdown();
+    }
+}
+
+void HttpServer::sendChunk(const TcpConnectionPtr &conn, const char *data, size_t len)
+{
+    if (len == 0)   // 长度为0的chunk会被当成结束
+    {
+        return;
+    }
+    Buffer output;
+    HttpResponse::appendChunk(&output, data, len);
+    // 在回调中直接发送会跑到还没发出的响应头前面，所以总是排队
+    conn->getLoop()->queueInLoop(std::bind(&HttpServer::sendChunkInLoop, conn, output.retrieveAllAsString()));
+}
+
+void HttpServer::sendChunkInLoop(const TcpConnectionPtr &conn, const std::string &chunk)
+{
+    HttpContext *context = static_cast<HttpContext *>(conn->getContext().get());
+    if (context != nullptr && context->streaming())
+    {
+        conn->send(chunk);
+    }
+}
+
+void HttpServer::finishChunked(const TcpConnectionPtr &conn)
+{
+    // 和sendChunk一样排队，保证在回调中调用时也在响应头和之前的chunk之后
+    conn->getLoop()->queueInLoop(std::bind(&HttpServer::finishChunkedInLoop, this, conn));
+}
+
+void HttpServer::finishChunkedInLoop(const TcpConnectionPtr &conn)
+{
+    HttpContext *context = static_cast<HttpContext *>(conn->getContext().get());
+    if (context == nullptr || !context->streaming() || !conn->connected())
+    {
+        return;
+    }
+    Buffer output;
+    HttpResponse::appendLastChunk(&output);
+    conn->send(&output);
+    context->setStreaming(false);
+
+    // 继续处理流式响应期间到达的请求
+    processRequests(conn, context, conn->inputBuffer(), Timestamp::now());
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+class HttpContext;
+
+/**
+ * 基于TcpServer的http/1.1服务器
+ * 支持keep-alive和流水线(pipelining)：一次onMessage中收到的多个请求依次解析、处理，
+ * 所有响应写到同一个Buffer里，最后只send一次，响应顺序和请求顺序一致
+ * */
+class HttpServer : noncopyable
+{
+public:
+    using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+    // 流式响应要用这个：回调中setStreaming(true)，返回后通过conn调用sendChunk、finishChunked继续发送
+    using StreamingHttpCallback = std::function<void(const TcpConnectionPtr &, const HttpRequest &, HttpResponse *)>;
+
+    HttpServer(EventLoop *loop,
+               const InetAddress &listenAddr,
+               const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    void setHttpCallback(const HttpCallback &cb);   // 拿不到连接，不能使用流式响应
+    void setHttpCallback(const StreamingHttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+
+    void start();
+
+    // 流式chunked响应：发送一个chunk，可以跨线程调用
+    // 和finishChunked一样总是排到连接所属的loop中执行，在回调中调用也会排在响应头之后
+    static void sendChunk(const TcpConnectionPtr &conn, const char *data, size_t len);
+    // 结束流式chunked响应，然后继续处理该连接上后续的请求，可以跨线程调用
+    void finishChunked(const TcpConnectionPtr &conn);
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    static void sendChunkInLoop(const TcpConnectionPtr &conn, const std::string &chunk);
+    void finishChunkedInLoop(const TcpConnectionPtr &conn);
+
+    // 依次处理buf中所有完整的请求
+    void processRequests(const TcpConnectionPtr &conn, HttpContext *context, Buffer *buf, Timestamp receiveTime);
+
+    TcpServer server_;
+    StreamingHttpCallback httpCallback_;
+};
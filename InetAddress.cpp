@@ -1,38 +1,161 @@
 #include <strings.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <algorithm>
 
 #include "InetAddress.h"
+#include "Logger.h"
 
 InetAddress::InetAddress(uint16_t port, std::string ip)
 {
-    ::memset(&addr_, 0, sizeof(addr_));   // 清0操作
+    ::memset(&addrUn_, 0, sizeof(addrUn_));   // 清0操作
+    if (ip.find(':') != std::string::npos)
+    {
+        addr6_.sin6_family = AF_INET6;
+        addr6_.sin6_port = ::htons(port);
+        ::inet_pton(AF_INET6, ip.c_str(), &addr6_.sin6_addr);
+        len_ = sizeof(sockaddr_in6);
+        return;
+    }
     addr_.sin_family = AF_INET;  // ipv4
     addr_.sin_port = ::htons(port); // 本地整型字节序转为网络字节序   host to net   s means short 16位， 端口号0~2^16-1
     addr_.sin_addr.s_addr = ::inet_addr(ip.c_str());
+    len_ = sizeof(sockaddr_in);
+}
+
+InetAddress::InetAddress(const sockaddr *addr, socklen_t len)
+{
+    setSockAddr(addr, len);
+}
+
+InetAddress InetAddress::unixDomain(const std::string &path, bool abstract)
+{
+    sockaddr_un un;
+    ::memset(&un, 0, sizeof un);
+    un.sun_family = AF_UNIX;
+    // 抽象命名空间的地址以'\0'开头，长度按实际名字计算，不包含结尾的'\0'
+    size_t offset = abstract ? 1 : 0;
+    size_t n = path.size();
+    if (n > sizeof(un.sun_path) - 1 - offset)
+    {
+        LOG_ERROR("InetAddress::unixDomain - path too long (%zu bytes, max %zu): %s\n",
+                  n, sizeof(un.sun_path) - 1 - offset, path.c_str());
+        return InetAddress(reinterpret_cast<const sockaddr *>(&un), 0);   // AF_UNSPEC
+    }
+    ::memcpy(un.sun_path + offset, path.data(), n);
+    socklen_t len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + offset + n + (abstract ? 0 : 1));
+    return InetAddress(reinterpret_cast<const sockaddr *>(&un), len);
+}
+
+void InetAddress::setSockAddr(const sockaddr *addr, socklen_t len)
+{
+    ::memset(&addrUn_, 0, sizeof(addrUn_));
+    len_ = std::min<socklen_t>(len, sizeof(addrUn_));
+    ::memcpy(&addrUn_, addr, len_);
+}
+
+bool InetAddress::isAbstract() const
+{
+    return isUnixDomain()
+           && len_ > offsetof(sockaddr_un, sun_path)
+           && addrUn_.sun_path[0] == '\0';
+}
+
+std::string InetAddress::unixPath() const
+{
+    if (!isUnixDomain() || len_ <= offsetof(sockaddr_un, sun_path))
+    {
+        return std::string();
+    }
+    size_t n = len_ - offsetof(sockaddr_un, sun_path);
+    if (addrUn_.sun_path[0] == '\0')
+    {
+        return "@" + std::string(addrUn_.sun_path + 1, n - 1);
+    }
+    return std::string(addrUn_.sun_path, ::strnlen(addrUn_.sun_path, n));
+}
+
+size_t InetAddress::formatIp(char *buf, size_t size) const
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    buf[0] = '\0';
+    if (isUnixDomain())
+    {
+        std::string path = unixPath();
+        size_t n = std::min(path.size(), size - 1);
+        ::memcpy(buf, path.data(), n);
+        buf[n] = '\0';
+        return n;
+    }
+    if (isIpv6())
+    {
+        ::inet_ntop(AF_INET6, &addr6_.sin6_addr, buf, static_cast<socklen_t>(size));
+    }
+    else
+    {
+        ::inet_ntop(AF_INET, &addr_.sin_addr, buf, static_cast<socklen_t>(size));
+    }
+    return ::strlen(buf);
+}
+
+size_t InetAddress::formatIpPort(char *buf, size_t size) const
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    int n = 0;
+    if (isUnixDomain())
+    {
+        n = snprintf(buf, size, "unix:");
+        n += static_cast<int>(formatIp(buf + n, size - n));
+        return n;
+    }
+    // ipv6地址中本身含有':'，用[]括起来再接端口
+    if (isIpv6())
+    {
+        n = snprintf(buf, size, "[");
+    }
+    n += static_cast<int>(formatIp(buf + n, size - n));
+    n += snprintf(buf + n, size - n, isIpv6() ? "]:%u" : ":%u", toPort());
+    return std::min(static_cast<size_t>(n), size - 1);
 }
 
 std::string InetAddress::toIp() const
 {
-    // addr_
-    char buf[64] = {0};
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
-    return buf;
+    if (isUnixDomain())
+    {
+        return unixPath();
+    }
+    char buf[kMaxIpPortLen];
+    size_t n = formatIp(buf, sizeof buf);
+    return std::string(buf, n);
 }
 
 std::string InetAddress::toIpPort() const
 {
+    if (isUnixDomain())
+    {
+        return "unix:" + unixPath();
+    }
     // ip:port
-    char buf[64] = {0};
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);  // ip转为主机字节序
-    size_t end = ::strlen(buf);
-    uint16_t port = ::ntohs(addr_.sin_port);
-    sprintf(buf+end, ":%u", port);
-    return buf;
+    char buf[kMaxIpPortLen];
+    size_t n = formatIpPort(buf, sizeof buf);
+    return std::string(buf, n);
 }
 
 uint16_t InetAddress::toPort() const
 {
-    return ::ntohs(addr_.sin_port);
+    if (isUnixDomain())
+    {
+        return 0;
+    }
+    // sin_port和sin6_port在两个结构体中的偏移相同
+    return ::ntohs(isIpv6() ? addr6_.sin6_port : addr_.sin_port);
 }
 
 #if 0
@@ -42,4 +165,4 @@ int main()
     InetAddress addr(8080);
     std::cout << addr.toIpPort() << std::endl;
 }
-#endif
\ No newline at end of file
+#endif
@@ -2,6 +2,8 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <string>
 
 /**
@@ -9,24 +11,64 @@
  * 将地址信息、ip端口这些内容封装起来
  * 并提供格式化输出
  * */
-// 封装socket地址类型
+// 封装socket地址类型，ipv4、ipv6或者unix域socket的地址
 class InetAddress
 {
 public:
+    // ip中含有':'时按ipv6解析，比如"::"、"::1"、"fe80::1"
     explicit InetAddress(uint16_t port = 0, std::string ip = "127.0.0.1");  // 传入 ip 和 端口
     explicit InetAddress(const sockaddr_in &addr)    // 传入sockaddr_in 结构体
         : addr_(addr)
+        , len_(sizeof(sockaddr_in))
     {
     }
+    explicit InetAddress(const sockaddr_in6 &addr)
+        : addr6_(addr)
+        , len_(sizeof(sockaddr_in6))
+    {
+    }
+    // accept、getsockname返回的通用地址，len为内核填写的地址长度
+    InetAddress(const sockaddr *addr, socklen_t len);
+
+    /**
+     * unix域socket的地址，同一台机器上的进程通信不经过tcp协议栈
+     * abstract为true时使用抽象命名空间：不在文件系统中创建文件，最后一个fd关闭后自动消失
+     * 路径放不进sun_path时不截断(截断后是另一个路径)，记录错误并返回无效地址，见isValid
+     * */
+    static InetAddress unixDomain(const std::string &path, bool abstract = false);
 
-    // 三种输出格式
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isValid() const { return family() != AF_UNSPEC; }
+    bool isIpv6() const { return family() == AF_INET6; }
+    bool isUnixDomain() const { return family() == AF_UNIX; }
+    bool isAbstract() const;
+    // unix域socket的路径，抽象命名空间的地址以'@'开头，未绑定的(比如客户端)为空
+    std::string unixPath() const;
+
+    // 三种输出格式，ipv6的toIpPort为"[ip]:port"，unix域地址没有ip和端口，toIpPort返回"unix:路径"
     std::string toIp() const;
     std::string toIpPort() const;  // ip+端口，字符串形式返回
     uint16_t toPort() const;
 
-    const sockaddr_in *getSockAddr() const { return &addr_; }
-    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; }
+    // 和toIp/toIpPort相同的格式，写到调用方的缓冲区中，不分配内存，返回写入的长度(不含'\0')
+    // kMaxIpPortLen足够放下任何ipv4/ipv6地址，unix域地址超出时截断
+    static const size_t kMaxIpPortLen = 64;
+    size_t formatIp(char *buf, size_t size) const;
+    size_t formatIpPort(char *buf, size_t size) const;
+
+    const sockaddr *getSockAddr() const { return reinterpret_cast<const sockaddr *>(&addr_); }
+    socklen_t getSockLen() const { return len_; }
+    const sockaddr_in *getSockAddrInet() const { return &addr_; }
+    const sockaddr_in6 *getSockAddrInet6() const { return &addr6_; }
+    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; len_ = sizeof(sockaddr_in); }
+    void setSockAddr(const sockaddr *addr, socklen_t len);
 
 private:
-    sockaddr_in addr_;
-};
\ No newline at end of file
+    union
+    {
+        sockaddr_in addr_;
+        sockaddr_in6 addr6_;
+        sockaddr_un addrUn_;
+    };
+    socklen_t len_;
+};
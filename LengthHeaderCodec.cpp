@@ -0,0 +1,53 @@
+#include "LengthHeaderCodec.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    // 一次可能收到多个帧，也可能只收到半个帧
+    while (buf->readableBytes() >= kHeaderLen)
+    {
+        const int32_t len = buf->peekInt32();
+        if (len < 0 || static_cast<size_t>(len) > maxFrameLength_)
+        {
+            LOG_ERROR("LengthHeaderCodec::onMessage [%s] invalid length %d\n", conn->name().c_str(), len);
+            buf->retrieveAll();
+            conn->shutdown();
+            break;
+        }
+        if (buf->readableBytes() < kHeaderLen + len)   // 帧还不完整
+        {
+            break;
+        }
+        StringPiece frame(buf->peek() + kHeaderLen, len);
+        frameCallback_(conn, frame, receiveTime);
+        buf->retrieve(kHeaderLen + len);   // 回调返回后再取走，回调期间frame一直有效
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *buf)
+{
+    int32_t len = static_cast<int32_t>(buf->readableBytes());
+    if (buf->prependableBytes() >= kHeaderLen)
+    {
+        buf->prependInt32(len);   // 长度写进预留区域，数据原地不动
+        conn->send(buf);
+    }
+    else
+    {
+        // buf在此之前已经被prepend过，没有预留空间了，只能另外拼一帧
+        Buffer frame;
+        frame.appendInt32(len);
+        frame.append(buf->peek(), buf->readableBytes());
+        buf->retrieveAll();
+        conn->send(&frame);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const StringPiece &message)
+{
+    Buffer buf;
+    buf.append(message.data(), message.size());
+    send(conn, &buf);
+}
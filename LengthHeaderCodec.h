@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+class Buffer;
+
+/**
+ * 长度头分包编解码器，解决粘包问题
+ * 每一帧: | int32 长度(网络字节序) | 数据 |
+ *
+ * 发送：用户把数据写进一个Buffer，长度用prependInt32写进Buffer预留的kCheapPrepend区域，数据不需要再拷贝
+ * 接收：设置为TcpServer的MessageCallback，每收到一个完整帧就回调一次，
+ *       帧以StringPiece的形式直接指向inputBuffer_，回调返回后才从Buffer中取走
+ * */
+class LengthHeaderCodec : noncopyable
+{
+public:
+    using FrameCallback = std::function<void(const TcpConnectionPtr &, const StringPiece &frame, Timestamp)>;
+
+    static const size_t kHeaderLen = sizeof(int32_t);
+    static const size_t kDefaultMaxFrameLength = 64 * 1024 * 1024;
+
+    explicit LengthHeaderCodec(const FrameCallback &cb, size_t maxFrameLength = kDefaultMaxFrameLength)
+        : frameCallback_(cb)
+        , maxFrameLength_(maxFrameLength)
+    {
+    }
+
+    // 绑定为TcpServer/TcpConnection的MessageCallback
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    // 把buf中的所有可读数据作为一帧发送，buf会被清空
+    void send(const TcpConnectionPtr &conn, Buffer *buf);
+    void send(const TcpConnectionPtr &conn, const StringPiece &message);
+
+private:
+    FrameCallback frameCallback_;
+    const size_t maxFrameLength_;
+};
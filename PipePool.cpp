@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "PipePool.h"
+#include "Logger.h"
+
+PipePool &PipePool::current()
+{
+    static thread_local PipePool pool;
+    return pool;
+}
+
+PipePool::PipePool()
+    : pipeSize_(kDefaultPipeSize)
+{
+}
+
+PipePool::~PipePool()
+{
+    for (const Pipe &pipe : idle_)
+    {
+        closePipe(pipe);
+    }
+}
+
+PipePool::Pipe PipePool::acquire()
+{
+    Pipe pipe;
+    if (!idle_.empty())
+    {
+        pipe = idle_.back();
+        idle_.pop_back();
+        return pipe;
+    }
+
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        LOG_ERROR("PipePool::acquire pipe2 error:%d\n", errno);
+        return pipe;
+    }
+    pipe.readFd = fds[0];
+    pipe.writeFd = fds[1];
+
+    if (::fcntl(pipe.writeFd, F_SETPIPE_SZ, kDefaultPipeSize) < 0)
+    {
+        int size = ::fcntl(pipe.writeFd, F_GETPIPE_SZ);
+        if (size > 0)
+        {
+            pipeSize_ = size;
+        }
+    }
+    return pipe;
+}
+
+void PipePool::release(Pipe pipe, bool empty)
+{
+    if (!pipe.valid())
+    {
+        return;
+    }
+    if (empty && idle_.size() < kMaxIdlePipes)
+    {
+        idle_.push_back(pipe);
+    }
+    else
+    {
+        closePipe(pipe);
+    }
+}
+
+void PipePool::closePipe(const Pipe &pipe)
+{
+    ::close(pipe.readFd);
+    ::close(pipe.writeFd);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "noncopyable.h"
+
+/**
+ * splice用的管道池
+ * 管道只是内核里的一段页缓存，splice(socket -> pipe -> socket)时数据不经过用户态
+ * 每个loop线程一个池(thread_local)，只在本线程中使用，不需要加锁
+ * 只有空管道才能回收复用，里面还有数据的直接关闭
+ * */
+class PipePool : noncopyable
+{
+public:
+    struct Pipe
+    {
+        int readFd = -1;
+        int writeFd = -1;
+        bool valid() const { return readFd >= 0; }
+    };
+
+    static const int kDefaultPipeSize = 256 * 1024;   // 默认64K，调大后一次splice能搬更多数据
+    static const size_t kMaxIdlePipes = 64;
+
+    // 当前线程(loop)的管道池
+    static PipePool &current();
+
+    ~PipePool();
+
+    Pipe acquire();   // 失败时返回的Pipe无效(fd耗尽等)，调用方回退到Buffer
+    void release(Pipe pipe, bool empty);
+
+    int pipeSize() const { return pipeSize_; }
+
+private:
+    PipePool();
+
+    static void closePipe(const Pipe &pipe);
+
+    int pipeSize_;   // 实际的管道容量，F_SETPIPE_SZ可能被pipe-max-size限制
+    std::vector<Pipe> idle_;
+};
@@ -30,6 +30,13 @@ public:
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
 
+    /**
+     * 一次poll最多返回的事件数和事件数组的初始大小，事件数组在两者之间自适应
+     * 一次最多处理maxEvents个事件，剩下的留在内核的就绪队列里下一轮再处理，
+     * 大量fd同时就绪时pendingFunctors和定时器也不会被饿死。不支持的Poller忽略
+     * */
+    virtual void setEventListLimits(int /*initialEvents*/, int /*maxEvents*/) {}
+
     // 判断当前channel是否在预设的 poll 中
     bool hasChannel(Channel *channel) const;
 
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+
+#include "SlabPool.h"
+#include "Logger.h"
+
+static const size_t kNumSizeClasses = SlabPool::kMaxBlockSize / SlabPool::kAlignment;
+static __thread bool t_exited = false;
+
+// 每个线程的各个尺寸的池，第一次分配时创建
+class SlabPool::ThreadCache
+{
+public:
+    ThreadCache()
+    {
+        for (size_t i = 0; i < kNumSizeClasses; ++i)
+        {
+            pools[i] = nullptr;
+        }
+    }
+    ~ThreadCache()
+    {
+        t_exited = true;   // 之后本线程的释放都走远程链表，分配走malloc
+        for (size_t i = 0; i < kNumSizeClasses; ++i)
+        {
+            if (pools[i] != nullptr)
+            {
+                pools[i]->orphan();
+            }
+        }
+    }
+
+    SlabPool *pools[kNumSizeClasses];
+};
+
+static thread_local SlabPool::ThreadCache t_cache;
+static __thread SlabPool::ThreadCache *t_cachePtr = nullptr;   // 指向t_cache，避免每次访问都检查thread_local是否已经构造
+
+void *SlabPool::allocate(size_t size)
+{
+    size_t blockSize = (size + kAlignment - 1) / kAlignment * kAlignment;
+    if (blockSize == 0)
+    {
+        blockSize = kAlignment;
+    }
+    if (blockSize > kMaxBlockSize || t_exited)
+    {
+        // 大块也按slab对齐，这样释放时不用区分
+        size_t bytes = (size + kSlabHeaderSize + kSlabSize - 1) / kSlabSize * kSlabSize;
+        SlabHeader *slab = static_cast<SlabHeader *>(::aligned_alloc(kSlabSize, bytes));
+        if (slab == nullptr)
+        {
+            LOG_FATAL("SlabPool::allocate aligned_alloc %lu bytes failed\n", bytes);
+        }
+        slab->owner = nullptr;
+        return reinterpret_cast<char *>(slab) + kSlabHeaderSize;
+    }
+
+    if (t_cachePtr == nullptr)
+    {
+        t_cachePtr = &t_cache;
+    }
+    SlabPool *&pool = t_cachePtr->pools[blockSize / kAlignment - 1];
+    if (pool == nullptr)
+    {
+        pool = new SlabPool(blockSize);
+        pool->cache_ = t_cachePtr;
+    }
+    return pool->allocateBlock();
+}
+
+void SlabPool::deallocate(void *p)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+    SlabHeader *slab = slabOf(p);
+    SlabPool *pool = slab->owner;
+    if (pool == nullptr)
+    {
+        ::free(slab);
+    }
+    else if (pool->cache_ == t_cachePtr && !t_exited)
+    {
+        pool->freeLocal(static_cast<FreeBlock *>(p));
+    }
+    else
+    {
+        pool->freeRemote(static_cast<FreeBlock *>(p));
+    }
+}
+
+SlabPool::SlabPool(size_t blockSize)
+    : blockSize_(blockSize)
+    , freeList_(nullptr)
+    , inUse_(0)
+    , remoteFree_(nullptr)
+    , cache_(nullptr)
+{
+}
+
+SlabPool::~SlabPool()
+{
+    for (char *slab : slabs_)
+    {
+        ::free(slab);
+    }
+}
+
+void *SlabPool::allocateBlock()
+{
+    if (freeList_ == nullptr && !drainRemote())
+    {
+        addSlab();
+    }
+    FreeBlock *block = freeList_;
+    freeList_ = block->next;
+    ++inUse_;
+    return block;
+}
+
+void SlabPool::freeLocal(FreeBlock *block)
+{
+    block->next = freeList_;
+    freeList_ = block;
+    --inUse_;
+}
+
+// 其他线程释放，压入无锁链表。取回时整个链表一次拿走，不存在ABA问题
+void SlabPool::freeRemote(FreeBlock *block)
+{
+    FreeBlock *head = remoteFree_.load(std::memory_order_relaxed);
+    do
+    {
+        block->next = head;
+    } while (!remoteFree_.compare_exchange_weak(head, block,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+}
+
+bool SlabPool::drainRemote()
+{
+    FreeBlock *block = remoteFree_.exchange(nullptr, std::memory_order_acquire);
+    if (block == nullptr)
+    {
+        return false;
+    }
+    while (block != nullptr)
+    {
+        FreeBlock *next = block->next;
+        freeLocal(block);
+        block = next;
+    }
+    return true;
+}
+
+void SlabPool::addSlab()
+{
+    char *slab = static_cast<char *>(::aligned_alloc(kSlabSize, kSlabSize));
+    if (slab == nullptr)
+    {
+        LOG_FATAL("SlabPool::addSlab aligned_alloc %lu bytes failed\n", kSlabSize);
+    }
+    reinterpret_cast<SlabHeader *>(slab)->owner = this;
+    slabs_.push_back(slab);
+    size_t count = (kSlabSize - kSlabHeaderSize) / blockSize_;
+    char *base = slab + kSlabHeaderSize;
+    for (size_t i = count; i > 0; --i)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(base + (i - 1) * blockSize_);
+        block->next = freeList_;
+        freeList_ = block;
+    }
+}
+
+void SlabPool::orphan()
+{
+    drainRemote();
+    if (inUse_ == 0)
+    {
+        delete this;
+    }
+    else
+    {
+        LOG_INFO("SlabPool::orphan %lu blocks of %lu bytes still in use, slabs not freed\n", inUse_, blockSize_);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "noncopyable.h"
+
+/**
+ * 每个loop线程一组的定长块内存池，TcpConnection、Channel、Socket这类随连接频繁创建销毁的对象从这里分配
+ * 按16字节对齐分成若干尺寸，每个尺寸一个SlabPool，一次向系统申请一整块(slab)再切成等长的块
+ * slab按kSlabSize对齐，开头的一个cache line记录它属于哪个池，块本身没有头部：
+ *   块的地址按kSlabSize取整就找到所属的池；块从cache line边界开始排列，64字节的对象正好占一个cache line
+ *   在所属线程释放时直接放回空闲链表，不加锁
+ *   在其他线程释放时压入所属池的无锁链表(remoteFree_)，由所属线程下次分配时整批取回
+ * 所以对象总是回到创建它的loop的池里，不会在线程之间漂移
+ * 线程退出时如果还有块没有归还，池不释放，交给进程退出时回收
+ * */
+class SlabPool : noncopyable
+{
+public:
+    static const size_t kAlignment = 16;
+    static const size_t kMaxBlockSize = 4096;   // 更大的单独占一个slab，不复用
+    static const size_t kSlabSize = 64 * 1024;
+    static const size_t kSlabHeaderSize = 64;
+
+    // 从当前线程的池中分配size字节，任意线程都可以调用
+    static void *allocate(size_t size);
+    // 释放allocate返回的内存，任意线程都可以调用
+    static void deallocate(void *p);
+
+    class ThreadCache;   // 每个线程各个尺寸的池
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+    struct SlabHeader
+    {
+        SlabPool *owner;   // nullptr表示是单独分配的大块
+    };
+    static SlabHeader *slabOf(void *p)
+    {
+        return reinterpret_cast<SlabHeader *>(reinterpret_cast<uintptr_t>(p) & ~(kSlabSize - 1));
+    }
+
+    explicit SlabPool(size_t blockSize);
+    ~SlabPool();
+
+    void *allocateBlock();
+    void freeLocal(FreeBlock *block);
+    void freeRemote(FreeBlock *block);
+    bool drainRemote();
+    void addSlab();
+    void orphan();   // 所属线程退出
+
+    const size_t blockSize_;
+    std::vector<char *> slabs_;
+    FreeBlock *freeList_;
+    size_t inUse_;   // 只在所属线程中修改，包含还没取回的远程释放
+    std::atomic<FreeBlock *> remoteFree_;
+    ThreadCache *cache_;   // 所属线程，用于判断释放发生在哪个线程
+};
+
+// 从当前线程的SlabPool中分配的标准分配器，配合std::allocate_shared让控制块和对象在同一个块中
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(SlabPool::allocate(n * sizeof(T))); }
+    void deallocate(T *p, size_t) { SlabPool::deallocate(p); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
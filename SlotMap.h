@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "noncopyable.h"
+
+/**
+ * 用64位id索引的对象表：高32位是代数(generation)，低32位是槽位下标
+ * 插入/查找/删除都是数组下标访问，不需要哈希；删除后槽位的代数加一，旧id不会查到新对象
+ * 空闲槽位用空闲链表复用，表只增不减
+ * 不是线程安全的，由调用方保证只在一个线程中访问
+ * */
+template <typename T>
+class SlotMap : noncopyable
+{
+public:
+    using Id = uint64_t;
+    static const Id kInvalidId = 0;   // 代数从1开始，合法的id不会是0
+
+    static uint32_t indexOf(Id id) { return static_cast<uint32_t>(id); }
+    static uint32_t generationOf(Id id) { return static_cast<uint32_t>(id >> 32); }
+
+    SlotMap() : size_(0) {}
+
+    // 下一次insert返回的id，用于对象在插入之前就需要知道自己的id的情况
+    Id nextId() const
+    {
+        if (!freeList_.empty())
+        {
+            uint32_t index = freeList_.back();
+            return makeId(slots_[index].generation, index);
+        }
+        return makeId(1, static_cast<uint32_t>(slots_.size()));
+    }
+
+    Id insert(T value)
+    {
+        uint32_t index;
+        if (!freeList_.empty())
+        {
+            index = freeList_.back();
+            freeList_.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+        Slot &slot = slots_[index];
+        slot.value = std::move(value);
+        slot.occupied = true;
+        ++size_;
+        return makeId(slot.generation, index);
+    }
+
+    // id已经被删除或者不存在时返回nullptr
+    T *find(Id id)
+    {
+        uint32_t index = indexOf(id);
+        if (index >= slots_.size())
+        {
+            return nullptr;
+        }
+        Slot &slot = slots_[index];
+        return slot.occupied && slot.generation == generationOf(id) ? &slot.value : nullptr;
+    }
+
+    bool erase(Id id)
+    {
+        T *value = find(id);
+        if (value == nullptr)
+        {
+            return false;
+        }
+        uint32_t index = indexOf(id);
+        Slot &slot = slots_[index];
+        slot.value = T();
+        slot.occupied = false;
+        if (++slot.generation == 0)
+        {
+            slot.generation = 1;
+        }
+        freeList_.push_back(index);
+        --size_;
+        return true;
+    }
+
+    // 删除所有的对象，之前的id全部失效
+    void clear()
+    {
+        for (size_t i = 0; i < slots_.size(); ++i)
+        {
+            if (slots_[i].occupied)
+            {
+                erase(makeId(slots_[i].generation, static_cast<uint32_t>(i)));
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 遍历所有的对象，f(Id, T&)，遍历过程中不能插入或删除
+    template <typename F>
+    void forEach(F f)
+    {
+        for (size_t i = 0; i < slots_.size(); ++i)
+        {
+            if (slots_[i].occupied)
+            {
+                f(makeId(slots_[i].generation, static_cast<uint32_t>(i)), slots_[i].value);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        T value;
+        uint32_t generation = 1;
+        bool occupied = false;
+    };
+
+    static Id makeId(uint32_t generation, uint32_t index)
+    {
+        return (static_cast<Id>(generation) << 32) | index;
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeList_;
+    size_t size_;
+};
@@ -3,7 +3,11 @@
 #include <sys/socket.h>
 #include <string.h>
 #include <netinet/tcp.h>
+#include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <errno.h>
 
 #include "Socket.h"
 #include "Logger.h"
@@ -16,8 +20,8 @@ Socket::~Socket()
 
 void Socket::bindAddress(const InetAddress &localaddr)
 {
-    // // sockaddr_in（ipv4） 强制转换为 sockaddr 通用地址
-    if (0 != ::bind(sockfd_, (sockaddr *)localaddr.getSockAddr(), sizeof(sockaddr_in)))
+    // 地址长度由InetAddress给出，ipv4和unix域socket的长度不同
+    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), localaddr.getSockLen()))
     {
         LOG_FATAL("bind sockfd:%d fail\n", sockfd_);
     }
@@ -41,14 +45,14 @@ int Socket::accept(InetAddress *peeraddr)
      * Reactor模型 one loop per thread
      * poller + non-blocking IO
      **/
-    sockaddr_in addr;
+    sockaddr_storage addr;   // 能放下任何协议族的地址
     socklen_t len = sizeof(addr);
     ::memset(&addr, 0, sizeof(addr));
     // fixed : int connfd = ::accept(sockfd_, (sockaddr *)&addr, &len);
     int connfd = ::accept4(sockfd_, (sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0)   // 已连接
     {
-        peeraddr->setSockAddr(addr);  // 传入addr
+        peeraddr->setSockAddr((sockaddr *)&addr, len);  // 传入addr
     }
     return connfd;   // 一个已连接的文件描述符fd
 }
@@ -63,6 +67,23 @@ void Socket::shutdownWrite()
     }
 }
 
+bool Socket::getTcpInfo(struct tcp_info *tcpi) const
+{
+    socklen_t len = sizeof(*tcpi);
+    ::memset(tcpi, 0, len);
+    return ::getsockopt(sockfd_, SOL_TCP, TCP_INFO, tcpi, &len) == 0;
+}
+
+int Socket::getSendQueueBytes() const
+{
+    int bytes = 0;
+    if (::ioctl(sockfd_, SIOCOUTQ, &bytes) < 0)
+    {
+        return -1;
+    }
+    return bytes;
+}
+
 // 糊涂窗口的问题。 setTcpNoDelay可以取消糊涂窗口，有数据就发送
 void Socket::setTcpNoDelay(bool on)
 {
@@ -84,9 +105,43 @@ void Socket::setReusePort(bool on)
     ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)); // TCP_NODELAY包含头文件 <netinet/tcp.h>
 }
 
+void Socket::setIpv6Only(bool on)
+{
+    int optval = on ? 1 : 0;
+    if (::setsockopt(sockfd_, IPPROTO_IPV6, IPV6_V6ONLY, &optval, sizeof(optval)) < 0)
+    {
+        LOG_ERROR("Socket::setIpv6Only fd=%d error:%d\n", sockfd_, errno);
+    }
+}
+
 //
 void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval)); // TCP_NODELAY包含头文件 <netinet/tcp.h>
-}
\ No newline at end of file
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+#ifdef SO_ZEROCOPY
+    int optval = on ? 1 : 0;
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) == 0)
+    {
+        return true;
+    }
+    LOG_ERROR("Socket::setZeroCopy fd=%d error:%d\n", sockfd_, errno);
+#endif
+    return false;
+}
+
+bool Socket::setBusyPoll(int usec)
+{
+#ifdef SO_BUSY_POLL
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0)
+    {
+        return true;
+    }
+    LOG_ERROR("Socket::setBusyPoll fd=%d error:%d\n", sockfd_, errno);
+#endif
+    return false;
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "SlabPool.h"
 
 class InetAddress;
+struct tcp_info;
 
 // 封装socket fd
 class Socket : noncopyable
@@ -16,6 +18,10 @@ public:
     }
     ~Socket();
 
+    // 随连接频繁创建销毁，从所在线程的内存池分配
+    static void *operator new(size_t size) { return SlabPool::allocate(size); }
+    static void operator delete(void *p) { SlabPool::deallocate(p); }
+
     int fd() const { return sockfd_; }   // socket返回的socketfd
     void bindAddress(const InetAddress &localaddr);   // 绑定地址，调用了socket中的bind函数操作
     void listen();   // 监听操作
@@ -23,10 +29,19 @@ public:
 
     void shutdownWrite();
 
+    // 通过getsockopt(TCP_INFO)获取内核中该连接的rtt、拥塞窗口、重传等统计信息，成功返回true
+    bool getTcpInfo(struct tcp_info *tcpi) const;
+    // 内核发送缓冲区中还未被对端确认的字节数(包括还未发送的)，失败返回-1
+    int getSendQueueBytes() const;
+
     void setTcpNoDelay(bool on);  // 保留糊涂窗口
     void setReuseAddr(bool on);   // 地址复用
     void setReusePort(bool on);  // 端口复用
+    void setIpv6Only(bool on);   // IPV6_V6ONLY，关闭时ipv6的socket同时接受ipv4连接(双栈)，需要在bind之前设置
     void setKeepAlive(bool on);  // 保活
+    bool setZeroCopy(bool on);   // SO_ZEROCOPY，之后才能用MSG_ZEROCOPY发送，内核不支持时返回false
+    // SO_BUSY_POLL，阻塞读或者没有数据时在驱动队列上忙等usec微秒，需要CAP_NET_ADMIN才能调大，失败返回false
+    bool setBusyPoll(int usec);
 
 private:
     const int sockfd_;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+#include <strings.h>
+
+/**
+ * 不拥有内存的字符串视图，指向Buffer等其他对象中的数据
+ * 只在被指向的数据有效期间有效，需要保存时用as_string()拷贝出来
+ * */
+class StringPiece
+{
+public:
+    StringPiece()
+        : ptr_(nullptr), length_(0) {}
+    StringPiece(const char *str)
+        : ptr_(str), length_(::strlen(str)) {}
+    StringPiece(const std::string &str)
+        : ptr_(str.data()), length_(str.size()) {}
+    StringPiece(const char *offset, size_t len)
+        : ptr_(offset), length_(len) {}
+
+    const char *data() const { return ptr_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    const char *begin() const { return ptr_; }
+    const char *end() const { return ptr_ + length_; }
+    char operator[](size_t i) const { return ptr_[i]; }
+
+    std::string as_string() const { return std::string(ptr_, length_); }
+
+    bool operator==(const StringPiece &x) const
+    {
+        return length_ == x.length_ && ::memcmp(ptr_, x.ptr_, length_) == 0;
+    }
+    bool operator!=(const StringPiece &x) const { return !(*this == x); }
+
+    // 大小写不敏感的比较，用于http头部字段名等
+    bool equalsIgnoreCase(const StringPiece &x) const
+    {
+        return length_ == x.length_ && ::strncasecmp(ptr_, x.ptr_, length_) == 0;
+    }
+
+private:
+    const char *ptr_;
+    size_t length_;
+};
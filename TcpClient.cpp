@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include "TcpClient.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "SlabPool.h"
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d loop is null!\n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+// TcpClient析构后，连接的关闭回调不能再指向TcpClient
+static void removeConnection(EventLoop *loop, const TcpConnectionPtr &conn)
+{
+    loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+TcpClient::TcpClient(EventLoop *loop,
+                     const InetAddress &serverAddr,
+                     const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , connector_(new Connector(loop, serverAddr))
+    , name_(nameArg)
+    , connNamePrefix_(std::make_shared<const std::string>(name_ + ":" + serverAddr.toIpPort() + "#"))
+    , retry_(false)
+    , connect_(true)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_INFO("TcpClient::TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient()
+{
+    LOG_INFO("TcpClient::~TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 连接注册在loop中时自己还持有一个引用
+        unique = connection_ && connection_.use_count() == (connection_->heldByLoop() ? 2 : 1);
+        conn = connection_;
+    }
+    if (conn)
+    {
+        // 连接可能比TcpClient活得久，把关闭回调换成不依赖TcpClient的版本
+        CloseCallback cb = std::bind(&::removeConnection, loop_, std::placeholders::_1);
+        loop_->runInLoop(
+            std::bind(&TcpConnection::setCloseCallback, conn, cb));
+        if (unique)
+        {
+            conn->forceClose();
+        }
+    }
+    else
+    {
+        connector_->stop();
+    }
+}
+
+void TcpClient::setRetryDelay(int initRetryDelayMs, int maxRetryDelayMs)
+{
+    connector_->setRetryDelay(initRetryDelayMs, maxRetryDelayMs);
+}
+
+void TcpClient::connect()
+{
+    LOG_INFO("TcpClient::connect[%s] - connecting to %s\n",
+             name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (connection_)
+    {
+        connection_->shutdown();
+    }
+}
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+    sockaddr_storage peer, local;
+    socklen_t peerlen = sizeof(peer);
+    ::memset(&peer, 0, sizeof(peer));
+    ::memset(&local, 0, sizeof(local));
+    if (::getpeername(sockfd, (sockaddr *)&peer, &peerlen) < 0)
+    {
+        LOG_ERROR("sockets::getPeerAddr");
+    }
+    socklen_t locallen = sizeof(local);
+    if (::getsockname(sockfd, (sockaddr *)&local, &locallen) < 0)
+    {
+        LOG_ERROR("sockets::getLocalAddr");
+    }
+    InetAddress peerAddr((sockaddr *)&peer, peerlen);
+    InetAddress localAddr((sockaddr *)&local, locallen);
+
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(PoolAllocator<TcpConnection>(),
+                                                                loop_,
+                                                                connNamePrefix_,
+                                                                nextConnId_++,
+                                                                sockfd,
+                                                                localAddr,
+                                                                peerAddr);
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    if (retry_ && connect_)
+    {
+        LOG_INFO("TcpClient::connect[%s] - Reconnecting to %s\n",
+                 name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
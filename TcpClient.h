@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+
+class Connector;
+class EventLoop;
+
+using ConnectorPtr = std::shared_ptr<Connector>;
+
+/**
+ * 客户端，用法和TcpServer一致
+ * Connector负责非阻塞地建立连接，连接成功后创建TcpConnection，回调也和TcpServer相同
+ * 所有io都在loop中完成，不需要单独的阻塞线程
+ * enableRetry之后，连接断开会自动重连
+ * */
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop,
+              const InetAddress &serverAddr,
+              const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();
+    void disconnect();   // 半关闭已经建立的连接
+    void stop();         // 停止正在进行的连接
+
+    TcpConnectionPtr connection() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop *getLoop() const { return loop_; }
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }   // 连接断开后自动重连
+    const std::string &name() const { return name_; }
+
+    // 重连的初始间隔和最大间隔
+    void setRetryDelay(int initRetryDelayMs, int maxRetryDelayMs);
+
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+
+private:
+    void newConnection(int sockfd);   // Connector连接成功的回调，在loop线程中执行
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+    const std::shared_ptr<const std::string> connNamePrefix_;   // "name:ip:port#"，连接名在用到时才拼上序号
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int64_t nextConnId_;   // 只在loop线程中使用
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;   // 由mutex_保护
+};
@@ -5,6 +5,8 @@
 #include <sys/socket.h>
 #include <string.h>
 #include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
 
 #include "TcpConnection.h"
 #include "Logger.h"
@@ -21,14 +23,27 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)  // /判断一个eventLoop
     return loop;
 }
 
-// void TcpServer::newConnection会调用
 TcpConnection::TcpConnection(EventLoop *loop,
                              const std::string &nameArg,
+                             int sockfd,
+                             const InetAddress &localAddr,
+                             const InetAddress &peerAddr)
+    : TcpConnection(loop, std::make_shared<const std::string>(nameArg), 0, sockfd, localAddr, peerAddr)
+{
+}
+
+// void TcpServer::newConnection会调用
+TcpConnection::TcpConnection(EventLoop *loop,
+                             const std::shared_ptr<const std::string> &namePrefix,
+                             int64_t sequence,
                              int sockfd,  // 接收连接以后返回的connectionfd
                              const InetAddress &localAddr,
                              const InetAddress &peerAddr)
     : loop_(CheckLoopNotNull(loop))
-    , name_(nameArg)
+    , namePrefix_(namePrefix)
+    , sequence_(sequence)
+    , id_(0)
+    , heldByLoop_(false)
     , state_(kConnecting)  //四种状态中的kConnecting
     , reading_(true)
     , socket_(new Socket(sockfd))    //
@@ -36,24 +51,116 @@ TcpConnection::TcpConnection(EventLoop *loop,
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64 * 1024 * 1024) // 64M
+    , zeroCopyThreshold_(0)
+    , zeroCopySeq_(0)
+    , zeroCopySends_(0)
+    , zeroCopyCopied_(0)
 {
-    // 下面给channel设置相应的回调函数 poller给channel通知感兴趣的事件发生了 channel会回调相应的回调函数
-    channel_->setReadCallback(
-        std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
-    channel_->setWriteCallback(
-        std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(
-        std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(
-        std::bind(&TcpConnection::handleError, this));
-
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
+    // poller给channel通知感兴趣的事件发生了 channel直接调用TcpConnection的handleRead/handleWrite/handleClose/handleError
+    channel_->setEventHandler(this);
+
+    char nameBuf[kMaxNameLen];
+    formatName(nameBuf, sizeof nameBuf);
+    LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", nameBuf, sockfd);
     socket_->setKeepAlive(true);
 }
 
+// 析构后每隔kZeroCopyLingerIntervalMs检查一次完成通知，最多等kZeroCopyLingerRetries次
+static const int kZeroCopyLingerIntervalMs = 10;
+static const int kZeroCopyLingerRetries = 500;
+
+struct TcpConnection::ZeroCopyLinger
+{
+    std::unique_ptr<Socket> socket;
+    std::deque<ZeroCopyBlock> blocks;
+};
+
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d\n", name_.c_str(), channel_->fd(), (int)state_);
+    char nameBuf[kMaxNameLen];
+    formatName(nameBuf, sizeof nameBuf);
+    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d\n", nameBuf, channel_->fd(), (int)state_);
+
+    if (!zeroCopyBlocks_.empty())
+    {
+        // 最后一块没发出去的部分不会再发，也不会有它的完成通知
+        ZeroCopyBlock &last = zeroCopyBlocks_.back();
+        last.len = last.sent;
+        if (last.sent == 0)
+        {
+            zeroCopyBlocks_.pop_back();
+        }
+    }
+    if (!zeroCopyBlocks_.empty())
+    {
+        std::shared_ptr<ZeroCopyLinger> pending = std::make_shared<ZeroCopyLinger>();
+        pending->socket = std::move(socket_);
+        pending->blocks.swap(zeroCopyBlocks_);
+        pending->socket->shutdownWrite();   // 和close一样，数据发完之后发FIN
+        lingerZeroCopy(loop_, pending, kZeroCopyLingerRetries);
+    }
+}
+
+const std::string &TcpConnection::name() const
+{
+    std::call_once(nameOnce_, [this]() {
+        name_ = *namePrefix_;
+        if (sequence_ > 0)
+        {
+            name_ += std::to_string(sequence_);
+        }
+    });
+    return name_;
+}
+
+size_t TcpConnection::formatName(char *buf, size_t size) const
+{
+    int n = sequence_ > 0
+            ? snprintf(buf, size, "%s%lld", namePrefix_->c_str(), static_cast<long long>(sequence_))
+            : snprintf(buf, size, "%s", namePrefix_->c_str());
+    if (n < 0)
+    {
+        n = 0;
+    }
+    return static_cast<size_t>(n) < size ? static_cast<size_t>(n) : size - 1;
+}
+
+bool TcpConnection::getTcpInfo(struct tcp_info *tcpi) const
+{
+    return socket_->getTcpInfo(tcpi);
+}
+
+std::string TcpConnection::getTcpInfoString() const
+{
+    char buf[1024] = {0};
+    struct tcp_info tcpi;
+    if (socket_->getTcpInfo(&tcpi))
+    {
+        snprintf(buf, sizeof buf, "unrecovered=%u "
+                 "rto=%u ato=%u snd_mss=%u rcv_mss=%u "
+                 "lost=%u retrans=%u rtt=%u rttvar=%u "
+                 "sshthresh=%u cwnd=%u total_retrans=%u unacked=%u sendq=%d",
+                 tcpi.tcpi_retransmits,  // 未恢复的超时重传次数
+                 tcpi.tcpi_rto,          // 重传超时时间，单位us
+                 tcpi.tcpi_ato,          // 延迟确认的超时时间，单位us
+                 tcpi.tcpi_snd_mss,
+                 tcpi.tcpi_rcv_mss,
+                 tcpi.tcpi_lost,         // 丢失的包
+                 tcpi.tcpi_retrans,      // 正在重传的包
+                 tcpi.tcpi_rtt,          // 平滑rtt，单位us
+                 tcpi.tcpi_rttvar,
+                 tcpi.tcpi_snd_ssthresh,
+                 tcpi.tcpi_snd_cwnd,
+                 tcpi.tcpi_total_retrans,  // 整个连接的重传次数
+                 tcpi.tcpi_unacked,        // 未被确认的包
+                 socket_->getSendQueueBytes());
+    }
+    return buf;
+}
+
+int TcpConnection::getSendQueueBytes() const
+{
+    return socket_->getSendQueueBytes();
 }
 
 void TcpConnection::send(const std::string &buf)
@@ -67,12 +174,59 @@ void TcpConnection::send(const std::string &buf)
         }
         else  // 外部线程调用
         {
+            // buf在functor执行时可能已经析构，所以拷贝一份
             loop_->runInLoop(
-                std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));   // 加到pendingFunctors_队列里
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf));   // 加到pendingFunctors_队列里
         }
     }
 }
 
+void TcpConnection::send(std::string &&message)
+{
+    size_t threshold = zeroCopyThreshold_;   // 完成通知可能在loop线程中把它清零
+    if (state_ == kConnected && threshold > 0 && message.size() >= threshold)
+    {
+        std::shared_ptr<std::string> holder = std::make_shared<std::string>(std::move(message));
+        loop_->runInLoop(
+            std::bind(&TcpConnection::sendZeroCopyInLoop, shared_from_this(), holder, holder->data(), holder->size()));
+    }
+    else
+    {
+        send(static_cast<const std::string &>(message));
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        size_t threshold = zeroCopyThreshold_;
+        if (threshold > 0 && buf->readableBytes() >= threshold)
+        {
+            // 把数据整个换出来交给连接保管，直到内核的完成通知到达
+            std::shared_ptr<Buffer> holder = std::make_shared<Buffer>();
+            holder->swap(*buf);
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendZeroCopyInLoop, shared_from_this(), holder, holder->peek(), holder->readableBytes()));
+        }
+        else if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf->retrieveAllAsString()));
+        }
+    }
+}
+
+void TcpConnection::sendStringInLoop(const std::string &message)
+{
+    sendInLoop(message.data(), message.size());
+}
+
 /**
  * 发送数据 应用写的快 而内核发送数据慢 需要把待发送数据写入缓冲区，而且设置了水位回调
  *
@@ -91,8 +245,8 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     }
 
     // 表示channel_第一次开始写数据或者缓冲区没有待发送数据
-    // 判断channel是否关注了写事件
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)  // outputBuffer_.readableBytes()为0说明内核缓冲区没满
+    // 判断channel是否关注了写事件；还有没发完的零拷贝块时也要排在它后面
+    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0 && !hasUnsentZeroCopy())  // outputBuffer_.readableBytes()为0说明内核缓冲区没满
     {
         nwrote = ::write(channel_->fd(), data, len);   // channel对应的fd中进行写操作，直接写到内核缓冲区
         if (nwrote >= 0)
@@ -144,6 +298,204 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     }
 }
 
+bool TcpConnection::enableZeroCopy(size_t threshold)
+{
+    if (!socket_->setZeroCopy(true))
+    {
+        return false;
+    }
+    zeroCopyThreshold_ = threshold > 0 ? threshold : 1;
+    channel_->setErrorQueueCallback(std::bind(&TcpConnection::handleErrorQueue, this));
+    return true;
+}
+
+void TcpConnection::sendZeroCopyInLoop(const std::shared_ptr<void> &holder, const char *data, size_t len)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing");
+        return;
+    }
+    if (zeroCopyThreshold_ == 0 || channel_->isWriting() || outputBuffer_.readableBytes() > 0 || hasUnsentZeroCopy())
+    {
+        // 前面还有没写进内核的数据，为了保证顺序拷贝到outputBuffer_后面
+        sendInLoop(data, len);
+        return;
+    }
+
+    ZeroCopyBlock block;
+    block.holder = holder;
+    block.data = data;
+    block.len = len;
+    block.sent = 0;
+    block.lastSeq = 0;
+    zeroCopyBlocks_.push_back(block);
+    if (!writeZeroCopy())
+    {
+        failZeroCopyWrite();
+        return;
+    }
+
+    if (hasUnsentZeroCopy() || outputBuffer_.readableBytes() > 0)
+    {
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+    }
+    else if (writeCompleteCallback_)
+    {
+        loop_->queueInLoop(
+            std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+}
+
+// 不是EAGAIN的写错误(EPIPE、ECONNRESET等)，连接已经不能用了
+// 不关闭的话没发完的块一直留在队尾，EPOLLOUT会一直触发，之后的发送也无法保证顺序
+void TcpConnection::failZeroCopyWrite()
+{
+    handleError();
+    forceCloseInLoop();
+}
+
+bool TcpConnection::writeZeroCopy()
+{
+    ZeroCopyBlock &block = zeroCopyBlocks_.back();
+    while (block.sent < block.len)
+    {
+        struct iovec iov;
+        iov.iov_base = const_cast<char *>(block.data + block.sent);
+        iov.iov_len = block.len - block.sent;
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        ssize_t n = ::sendmsg(channel_->fd(), &msg, MSG_ZEROCOPY);
+        if (n > 0)
+        {
+            block.sent += n;
+            block.lastSeq = zeroCopySeq_++;   // 每次成功的调用占一个序号，完成通知按序号区间返回
+            ++zeroCopySends_;
+        }
+        else if (errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        else if (errno == ENOBUFS)
+        {
+            // 超过了optmem_max，剩下的拷贝到outputBuffer_最前面，保证在已有数据之前发出
+            Buffer output;
+            output.append(block.data + block.sent, block.len - block.sent);
+            output.append(outputBuffer_.peek(), outputBuffer_.readableBytes());
+            outputBuffer_.swap(output);
+            block.len = block.sent;
+            if (block.sent == 0)
+            {
+                zeroCopyBlocks_.pop_back();   // 一次都没发出去，不会有完成通知
+            }
+            break;
+        }
+        else
+        {
+            LOG_ERROR("TcpConnection::writeZeroCopy errno:%d\n", errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 错误队列中的完成通知：序号区间[ee_info, ee_data]内的发送，内核已经不再引用用户内存
+int TcpConnection::readZeroCopyCompletions(int fd, std::deque<ZeroCopyBlock> *blocks, int *copied)
+{
+    int completions = 0;
+    char control[128];
+    for (;;)
+    {
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;   // EAGAIN，错误队列已经读空了
+        }
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            bool recvErr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                           || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recvErr)
+            {
+                continue;
+            }
+            const struct sock_extended_err *serr =
+                reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+            {
+                continue;
+            }
+            ++completions;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                ++*copied;
+            }
+            // TCP的完成通知是按顺序的，序号不超过ee_data的块都可以释放了，序号回绕时按差值比较
+            uint32_t hi = serr->ee_data;
+            while (!blocks->empty())
+            {
+                const ZeroCopyBlock &block = blocks->front();
+                if (block.sent < block.len || static_cast<int32_t>(hi - block.lastSeq) < 0)
+                {
+                    break;
+                }
+                blocks->pop_front();
+            }
+        }
+    }
+    return completions;
+}
+
+void TcpConnection::handleErrorQueue()
+{
+    int copied = 0;
+    if (readZeroCopyCompletions(channel_->fd(), &zeroCopyBlocks_, &copied) == 0)
+    {
+        handleError();   // 不是完成通知，是真正的socket错误
+        return;
+    }
+    if (copied > 0)
+    {
+        zeroCopyCopied_ += copied;
+        if (zeroCopyThreshold_ > 0)
+        {
+            // 内核最后还是拷贝了(比如回环地址、网卡不支持分散发送)，只剩下通知的开销，后面的发送不再用零拷贝
+            LOG_INFO("TcpConnection::handleErrorQueue [%s] kernel copied, zerocopy disabled\n", name().c_str());
+            zeroCopyThreshold_ = 0;
+        }
+    }
+}
+
+void TcpConnection::lingerZeroCopy(EventLoop *loop, const std::shared_ptr<ZeroCopyLinger> &pending, int retries)
+{
+    int copied = 0;
+    readZeroCopyCompletions(pending->socket->fd(), &pending->blocks, &copied);
+    if (pending->blocks.empty())
+    {
+        return;   // pending随之析构，关闭socket、释放数据
+    }
+    if (retries == 0)
+    {
+        // 对端一直不确认，用RST关闭，内核丢弃发送队列，不会再引用这些数据
+        LOG_ERROR("TcpConnection::lingerZeroCopy fd=%d - %zu blocks unacknowledged, reset\n",
+                  pending->socket->fd(), pending->blocks.size());
+        struct linger lg = {1, 0};
+        ::setsockopt(pending->socket->fd(), SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        return;
+    }
+    loop->runAfter(kZeroCopyLingerIntervalMs,
+                   std::bind(&TcpConnection::lingerZeroCopy, loop, pending, retries - 1));
+}
+
 void TcpConnection::shutdown()
 {
     if (state_ == kConnected)   // 已连接
@@ -163,11 +515,89 @@ void TcpConnection::shutdownInLoop()
     }
 }
 
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        // 放到下一轮执行，避免在handleEvent中途关闭
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();   // 和对端关闭一样，最终执行closeCallback_
+    }
+}
+
+bool TcpConnection::setBusyPoll(int usec)
+{
+    return socket_->setBusyPoll(usec);
+}
+
+int TcpConnection::fd() const
+{
+    return channel_->fd();
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+    if (!reading_ || !channel_->isReading())
+    {
+        channel_->enableReading();
+        reading_ = true;
+    }
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    if (reading_ || channel_->isReading())
+    {
+        channel_->disableReading();
+        reading_ = false;
+    }
+}
+
+void TcpConnection::startWriteWatch()
+{
+    if (!channel_->isWriting())
+    {
+        channel_->enableWriting();
+    }
+}
+
+void TcpConnection::stopWriteWatch()
+{
+    if (channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    {
+        channel_->disableWriting();
+    }
+}
+
 // 连接建立
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
-    channel_->tie(shared_from_this());
+    // 不用channel_->tie：tie要求每个事件都weak_ptr::lock一次，对控制块做一次原子加减，多核下这个cache line来回争用
+    // 改为连接自己持有一个引用，直到connectDestroyed把channel从poller移除后才放掉，
+    // 所以channel注册在poller期间连接一定活着。connectDestroyed总是在所属loop的pendingFunctors中执行，
+    // 绑定它的functor还持有一个引用，连接最终在这一轮doPendingFunctors结束时在所属loop中析构
+    self_ = shared_from_this();
+    heldByLoop_ = true;
     channel_->enableReading(); // 向poller注册channel的EPOLLIN读事件
 
     // 新连接建立 执行回调
@@ -185,6 +615,8 @@ void TcpConnection::connectDestroyed()
         connectionCallback_(shared_from_this());
     }
     channel_->remove(); // 把channel从poller中删除掉
+    heldByLoop_ = false;
+    self_.reset();   // 调用方(queueInLoop绑定的functor)还持有引用，这里不会析构
 }
 
 /**
@@ -196,6 +628,11 @@ void TcpConnection::connectDestroyed()
 // 当对端客户端有数据到达 服务器端检测到EPOLLIN 就会触发该fd上的回调 handleRead取读走对端发来的数据
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (relayHooks_.onReadable)
+    {
+        relayHooks_.onReadable();   // 数据由转发方直接搬给对端，不经过inputBuffer_
+        return;
+    }
     int savedErrno = 0;
     // 已连接的文件描述符对应的数据读入到内核缓冲区
     ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
@@ -220,6 +657,29 @@ void TcpConnection::handleWrite()
 {
     if (channel_->isWriting())
     {
+        if (hasUnsentZeroCopy())
+        {
+            // 零拷贝的数据排在outputBuffer_前面，先发完
+            if (!writeZeroCopy())
+            {
+                failZeroCopyWrite();
+                return;
+            }
+            if (hasUnsentZeroCopy())
+            {
+                return;
+            }
+            if (outputBuffer_.readableBytes() == 0)
+            {
+                outputDrained();
+                return;
+            }
+        }
+        if (outputBuffer_.readableBytes() == 0 && relayHooks_.onWritable)
+        {
+            relayHooks_.onWritable();   // 这次可写事件是转发方关注的
+            return;
+        }
         int savedErrno = 0;
         // 写n个数据
         ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);  // 将outputBuffer中readable部分的内容写入到内核缓冲区中
@@ -231,21 +691,7 @@ void TcpConnection::handleWrite()
             // 当内核缓冲区空出来后，又会触发写事件，那么会再次执行handleWrite，直至数据全部写进去
             if (outputBuffer_.readableBytes() == 0)
             {
-                // 当数据全都写进去之后，要关闭写事件
-                // 因为内核缓冲区一旦有空间，就会触发写事件，
-                // 不关闭的话，epoll就会一直循环不会阻塞，触发写事件
-                // 读事件不需要关闭，因为是监测内核缓冲区是否有数据到来，有数据才需要读事件
-                channel_->disableWriting();
-                if (writeCompleteCallback_)   // 如果设置了，那么就把设置的cb加到队列当中。没设置则不管
-                {
-                    // TcpConnection对象在其所在的subloop中 向pendingFunctors_中加入回调
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                if (state_ == kDisconnecting)   // 关闭写，但可读，半关闭
-                {
-                    shutdownInLoop(); // 在当前所属的loop中把TcpConnection删除掉
-                }
+                outputDrained();
             }
         }
         else
@@ -259,6 +705,29 @@ void TcpConnection::handleWrite()
     }
 }
 
+void TcpConnection::outputDrained()
+{
+    // 当数据全都写进去之后，要关闭写事件
+    // 因为内核缓冲区一旦有空间，就会触发写事件，
+    // 不关闭的话，epoll就会一直循环不会阻塞，触发写事件
+    // 读事件不需要关闭，因为是监测内核缓冲区是否有数据到来，有数据才需要读事件
+    channel_->disableWriting();
+    if (writeCompleteCallback_)   // 如果设置了，那么就把设置的cb加到队列当中。没设置则不管
+    {
+        // TcpConnection对象在其所在的subloop中 向pendingFunctors_中加入回调
+        loop_->queueInLoop(
+            std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (relayHooks_.onWritable)
+    {
+        relayHooks_.onWritable();   // outputBuffer_发完了，接着发转发方积压的数据
+    }
+    if (state_ == kDisconnecting)   // 关闭写，但可读，半关闭
+    {
+        shutdownInLoop(); // 在当前所属的loop中把TcpConnection删除掉
+    }
+}
+
 void TcpConnection::handleClose()
 {
     LOG_INFO("TcpConnection::handleClose fd=%d state=%d\n", channel_->fd(), (int)state_);
@@ -266,6 +735,12 @@ void TcpConnection::handleClose()
     channel_->disableAll();
 
     TcpConnectionPtr connPtr(shared_from_this());
+    RelayHooks hooks;
+    std::swap(hooks, relayHooks_);   // 先摘下来，onClose执行完后转发方可能随之析构
+    if (hooks.onClose)
+    {
+        hooks.onClose();
+    }
     connectionCallback_(connPtr); // 执行连接关闭的回调
     // TcpServer::removeConnection
     closeCallback_(connPtr);      // 执行关闭连接的回调 执行的是TcpServer::removeConnection回调方法   // must be the last line
@@ -284,5 +759,5 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name_.c_str(), err);
+    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d\n", name().c_str(), err);
 }
\ No newline at end of file
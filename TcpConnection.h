@@ -3,16 +3,22 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
 
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "Timestamp.h"
+#include "EventHandler.h"
 
 class Channel;
 class EventLoop;
 class Socket;
+struct tcp_info;
 
 /**
  * TcpServer => Acceptor => 有一个新用户连接，通过accept函数拿到connfd
@@ -24,7 +30,8 @@ class Socket;
  * */
 
 
-class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
+// 作为自己的Channel的EventHandler，事件直接分发到handleRead/handleWrite等
+class TcpConnection final : noncopyable, public EventHandler, public std::enable_shared_from_this<TcpConnection>
 {
 public:
     TcpConnection(EventLoop *loop,
@@ -32,19 +39,40 @@ public:
                   int sockfd,
                   const InetAddress &localAddr,
                   const InetAddress &peerAddr);
+    // 名字为namePrefix+sequence，只有调用name()时才格式化，建立连接的路径上不分配内存
+    TcpConnection(EventLoop *loop,
+                  const std::shared_ptr<const std::string> &namePrefix,
+                  int64_t sequence,
+                  int sockfd,
+                  const InetAddress &localAddr,
+                  const InetAddress &peerAddr);
     ~TcpConnection();
 
     EventLoop *getLoop() const { return loop_; }  // 获取子loop ，子loop是通过轮循的方式分发下来的
-    const std::string &name() const { return name_; }
+    const std::string &name() const;   // 第一次调用时格式化，可以跨线程调用
+    static const size_t kMaxNameLen = 128;
+    // 把名字格式化到buf中，不分配内存，返回写入的长度(不含结尾的0)
+    size_t formatName(char *buf, size_t size) const;
+    // 所属TcpServer分配的连接id，0表示没有分配
+    uint64_t id() const { return id_; }
+    void setId(uint64_t id) { id_ = id; }
     const InetAddress &localAddress() const { return localAddr_; }
     const InetAddress &peerAddress() const { return peerAddr_; }
 
     bool connected() const { return state_ == kConnected; }  // 判断当前连接是否已连接
 
+    // 传输层统计信息，rtt、拥塞窗口、重传次数、未确认的包等，用于判断慢连接是网络问题还是loop自身的问题
+    bool getTcpInfo(struct tcp_info *tcpi) const;
+    std::string getTcpInfoString() const;
+    int getSendQueueBytes() const;   // 内核发送队列中的字节数
+
     // 发送数据
     void send(const std::string &buf);   // 将一个buffer发送出去
+    void send(std::string &&message);   // 接管message，开启零拷贝且足够大时不再拷贝
+    void send(Buffer *buf);   // 发送buf中所有可读的数据，并清空buf
     // 关闭连接
     void shutdown();   // 调用的是socket的shutdownWrite，是个半关闭的状态
+    void forceClose();   // 不等对端，直接关闭连接，走和对端关闭一样的handleClose流程
 
     // 五种设置相应回调的操作
     // tcpServer中，建立新连接后可以设置tcpConnection的回调
@@ -62,10 +90,59 @@ public:
     void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
     { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+    // 上层协议(如HttpServer)挂在连接上的状态，比如每个连接的解析器
+    void setContext(const std::shared_ptr<void> &context) { context_ = context; }
+    const std::shared_ptr<void> &getContext() const { return context_; }
+
+    /**
+     * 大块数据用MSG_ZEROCOPY发送，内核直接引用用户内存，省掉一次拷贝
+     * 只对send(Buffer*)和send(std::string&&)这种能接管数据的发送生效，数据保存在连接里，
+     * 直到错误队列中的完成通知到达才释放；小于threshold的仍然拷贝
+     * 在loop线程中调用(比如连接回调里)，内核不支持SO_ZEROCOPY时返回false
+     * */
+    static const size_t kDefaultZeroCopyThreshold = 32 * 1024;
+    bool enableZeroCopy(size_t threshold = kDefaultZeroCopyThreshold);
+    bool zeroCopyEnabled() const { return zeroCopyThreshold_ > 0; }
+    size_t zeroCopyPendingBlocks() const { return zeroCopyBlocks_.size(); }   // 还在等完成通知的块
+    int64_t zeroCopySends() const { return zeroCopySends_; }     // MSG_ZEROCOPY的sendmsg次数
+    int64_t zeroCopyCopied() const { return zeroCopyCopied_; }   // 内核最终还是拷贝了的完成通知数
+
+    // 给这个连接的socket设置SO_BUSY_POLL，配合EventLoop::setBusyPoll使用
+    bool setBusyPoll(int usec);
+
+    Buffer *inputBuffer() { return &inputBuffer_; }
+    Buffer *outputBuffer() { return &outputBuffer_; }
+
+    int fd() const;
+    // 暂停/恢复读事件，用于把背压传给对端，线程安全
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    /**
+     * 转发(TcpRelay)接管连接的读写事件，只能在loop线程中设置
+     * onReadable: 设置后handleRead不再读入inputBuffer_，由转发方直接splice走数据
+     * onWritable: outputBuffer_为空时的可写事件交给转发方，用来发送管道中积压的数据
+     * onClose:    连接关闭时通知转发方
+     * */
+    struct RelayHooks
+    {
+        std::function<void()> onReadable;
+        std::function<void()> onWritable;
+        std::function<void()> onClose;
+    };
+    void setRelayHooks(const RelayHooks &hooks) { relayHooks_ = hooks; }
+    // 转发方关注/取消关注可写事件，outputBuffer_非空时由handleWrite自己管理
+    void startWriteWatch();
+    void stopWriteWatch();
+
     // 连接建立
     void connectEstablished();
     // 连接销毁
     void connectDestroyed();
+    // connectEstablished之后到connectDestroyed之前，连接持有自己的一个引用，保证事件分发时不会被析构
+    // 其他线程(比如TcpClient析构时)也会读，所以不读self_本身，读和它一起修改的heldByLoop_
+    bool heldByLoop() const { return heldByLoop_; }
 
 private:
     enum StateE
@@ -78,18 +155,49 @@ private:
     void setState(StateE state) { state_ = state; }
 
     // 可以对应成事件的读、写、关闭、错误。  这四个事件也是在channel中注册
-    void handleRead(Timestamp receiveTime);
-    void handleWrite();
-    void handleClose();
-    void handleError();
+    void handleRead(Timestamp receiveTime) override;
+    void handleWrite() override;
+    void handleClose() override;
+    void handleError() override;
+    void handleErrorQueue();   // 读错误队列，处理MSG_ZEROCOPY的完成通知
+    void outputDrained();      // 待发送的数据都写进内核之后
 
     void sendInLoop(const void *data, size_t len);
+    void sendStringInLoop(const std::string &message);   // 跨线程发送时，数据拷贝一份随functor一起传递
     void shutdownInLoop();
+    void forceCloseInLoop();
+    // 零拷贝发送的一块数据，最多只有最后一块还有没发出去的部分
+    struct ZeroCopyBlock
+    {
+        std::shared_ptr<void> holder;   // 持有数据，完成通知到达前不能释放
+        const char *data;
+        size_t len;
+        size_t sent;
+        uint32_t lastSeq;   // 最后一次sendmsg的序号，sent为0时无效
+    };
+    void sendZeroCopyInLoop(const std::shared_ptr<void> &holder, const char *data, size_t len);
+    bool writeZeroCopy();   // 发送最后一块中还没发出去的部分，出错返回false
+    void failZeroCopyWrite();   // writeZeroCopy出错时关闭连接
+    bool hasUnsentZeroCopy() const
+    { return !zeroCopyBlocks_.empty() && zeroCopyBlocks_.back().sent < zeroCopyBlocks_.back().len; }
+    // 读错误队列中的完成通知，释放已完成的块，返回通知数，copied累加内核最终拷贝了的通知数
+    static int readZeroCopyCompletions(int fd, std::deque<ZeroCopyBlock> *blocks, int *copied);
+    // 连接析构时内核可能还在引用零拷贝的数据，socket和数据一起留到完成通知到达之后再释放
+    struct ZeroCopyLinger;
+    static void lingerZeroCopy(EventLoop *loop, const std::shared_ptr<ZeroCopyLinger> &pending, int retries);
+    void startReadInLoop();
+    void stopReadInLoop();
 
 
     // 这里是baseloop还是subloop由TcpServer中创建的线程数决定 若为多Reactor 该loop_指向subloop 若为单Reactor 该loop_指向baseloop
     EventLoop *loop_;
-    const std::string name_;
+    const std::shared_ptr<const std::string> namePrefix_;   // 同一个TcpServer的连接共享
+    const int64_t sequence_;   // 小于等于0时名字就是namePrefix_
+    mutable std::once_flag nameOnce_;
+    mutable std::string name_;
+    uint64_t id_;
+    std::shared_ptr<TcpConnection> self_;   // 只在所属loop中修改，见connectEstablished
+    std::atomic_bool heldByLoop_;           // self_是否持有引用，紧跟着self_修改
     std::atomic_int state_;   // 原子int类型
     bool reading_;
 
@@ -111,6 +219,15 @@ private:
     // 数据缓冲区
     Buffer inputBuffer_;    // 接收数据的缓冲区
     Buffer outputBuffer_;   // 发送数据的缓冲区 用户send向outputBuffer_发
+
+    std::shared_ptr<void> context_;   // 上层协议的连接状态
+    RelayHooks relayHooks_;
+
+    std::atomic<size_t> zeroCopyThreshold_;   // 0表示不用零拷贝，send()在调用方线程中读取
+    uint32_t zeroCopySeq_;       // 下一次MSG_ZEROCOPY发送的序号，和内核的计数保持一致
+    std::deque<ZeroCopyBlock> zeroCopyBlocks_;
+    int64_t zeroCopySends_;
+    int64_t zeroCopyCopied_;
 };
 
 
@@ -0,0 +1,121 @@
+#include <netinet/tcp.h>
+
+#include "TcpInfoSampler.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+
+TcpInfoSampler::TcpInfoSampler(EventLoop *loop, int intervalMs)
+    : loop_(loop)
+    , intervalMs_(intervalMs)
+    , timerId_(0)
+    , started_(false)
+{
+}
+
+TcpInfoSampler::~TcpInfoSampler()
+{
+}
+
+void TcpInfoSampler::start()
+{
+    loop_->runInLoop(std::bind(&TcpInfoSampler::startInLoop, this));
+}
+
+void TcpInfoSampler::stop()
+{
+    loop_->runInLoop(std::bind(&TcpInfoSampler::stopInLoop, this));
+}
+
+void TcpInfoSampler::addConnection(const TcpConnectionPtr &conn)
+{
+    loop_->runInLoop(std::bind(&TcpInfoSampler::addConnectionInLoop, this, conn));
+}
+
+void TcpInfoSampler::removeConnection(const TcpConnectionPtr &conn)
+{
+    loop_->runInLoop(std::bind(&TcpInfoSampler::removeConnectionInLoop, this, conn.get()));
+}
+
+TcpInfoStats TcpInfoSampler::stats() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void TcpInfoSampler::startInLoop()
+{
+    if (!started_)
+    {
+        started_ = true;
+        timerId_ = loop_->runEvery(intervalMs_, std::bind(&TcpInfoSampler::sample, this));
+    }
+}
+
+void TcpInfoSampler::stopInLoop()
+{
+    if (started_)
+    {
+        started_ = false;
+        loop_->cancel(timerId_);
+    }
+    connections_.clear();
+}
+
+void TcpInfoSampler::addConnectionInLoop(const TcpConnectionPtr &conn)
+{
+    connections_[conn.get()] = conn;
+}
+
+void TcpInfoSampler::removeConnectionInLoop(const TcpConnection *conn)
+{
+    connections_.erase(conn);
+}
+
+// 对每个连接只做一次getsockopt和一次ioctl，汇总后只在最后加一次锁
+void TcpInfoSampler::sample()
+{
+    TcpInfoStats stats;
+    stats.sampleTimeUs = Timer::nowMicros();
+
+    struct tcp_info tcpi;
+    for (auto it = connections_.begin(); it != connections_.end(); )
+    {
+        TcpConnectionPtr conn = it->second.lock();
+        if (!conn || !conn->connected())   // 连接已经断开，顺便移除
+        {
+            it = connections_.erase(it);
+            continue;
+        }
+        ++it;
+
+        if (!conn->getTcpInfo(&tcpi))
+        {
+            continue;
+        }
+        if (stats.connections == 0 || tcpi.tcpi_rtt < stats.minRttUs)
+        {
+            stats.minRttUs = tcpi.tcpi_rtt;
+        }
+        if (stats.connections == 0 || tcpi.tcpi_rtt > stats.maxRttUs)
+        {
+            stats.maxRttUs = tcpi.tcpi_rtt;
+            stats.maxRttConnection = conn->name();
+        }
+        if (stats.connections == 0 || tcpi.tcpi_snd_cwnd < stats.minCwnd)
+        {
+            stats.minCwnd = tcpi.tcpi_snd_cwnd;
+        }
+        stats.sumRttUs += tcpi.tcpi_rtt;
+        stats.totalRetrans += tcpi.tcpi_total_retrans;
+        stats.totalUnacked += tcpi.tcpi_unacked;
+        int sendq = conn->getSendQueueBytes();
+        if (sendq > 0)
+        {
+            stats.sendQueueBytes += sendq;
+        }
+        ++stats.connections;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_ = std::move(stats);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "nonCopyable.h"
+#include "Callbacks.h"
+#include "Timer.h"
+
+class EventLoop;
+class TcpConnection;
+
+// 一次采样中，一个loop上所有连接的传输层统计信息的汇总
+struct TcpInfoStats
+{
+    int64_t sampleTimeUs = 0;       // 采样时间，单调时钟微秒数
+    size_t connections = 0;         // 本次采样的连接数
+    uint32_t minRttUs = 0;          // rtt 最小/最大/总和，单位us
+    uint32_t maxRttUs = 0;
+    uint64_t sumRttUs = 0;
+    uint32_t minCwnd = 0;           // 最小的拥塞窗口，单位mss
+    uint64_t totalRetrans = 0;      // 所有连接的累计重传次数
+    uint64_t totalUnacked = 0;      // 所有连接未被确认的包
+    uint64_t sendQueueBytes = 0;    // 所有连接内核发送队列中的字节数
+    std::string maxRttConnection;   // rtt最大的连接，慢客户端优先从这里查
+
+    uint32_t avgRttUs() const { return connections == 0 ? 0 : static_cast<uint32_t>(sumRttUs / connections); }
+};
+
+/**
+ * 每个EventLoop一个的TCP_INFO采样器
+ * 定时器在所属loop中触发，依次对loop上的连接调用getsockopt(TCP_INFO)，汇总成TcpInfoStats
+ * 连接和定时器都只在所属loop线程中访问，不需要加锁；只有汇总结果stats_会被其他线程读取
+ * */
+class TcpInfoSampler : nonCopyable
+{
+public:
+    TcpInfoSampler(EventLoop *loop, int intervalMs);
+    ~TcpInfoSampler();
+
+    // 开始/停止周期采样，可以跨线程调用
+    void start();
+    void stop();
+
+    // 添加/删除需要采样的连接，可以跨线程调用。已经断开的连接在采样时也会被自动移除
+    void addConnection(const TcpConnectionPtr &conn);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    // 最近一次采样的结果，任意线程都可以调用
+    TcpInfoStats stats() const;
+
+    EventLoop *getLoop() const { return loop_; }
+
+private:
+    void startInLoop();
+    void stopInLoop();
+    void addConnectionInLoop(const TcpConnectionPtr &conn);
+    void removeConnectionInLoop(const TcpConnection *conn);
+    void sample();   // 定时器回调
+
+    EventLoop *loop_;
+    const int intervalMs_;
+    TimerId timerId_;
+    bool started_;
+
+    // 以连接对象的地址为key，不用格式化和哈希连接名；地址被新连接复用时旧的记录已经失效，直接覆盖
+    std::unordered_map<const TcpConnection *, std::weak_ptr<TcpConnection>> connections_;
+
+    mutable std::mutex mutex_;
+    TcpInfoStats stats_;
+};
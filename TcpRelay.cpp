@@ -0,0 +1,326 @@
+#include <fcntl.h>
+#include <errno.h>
+
+#include "TcpRelay.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+TcpRelay::TcpRelay(const TcpConnectionPtr &a,
+                   const TcpConnectionPtr &b,
+                   size_t highWaterMark)
+    : loop_(a->getLoop())
+    , highWaterMark_(highWaterMark)
+    , useSplice_(true)
+    , spliceMode_(false)
+    , finished_(false)
+{
+    forward_.src = a;
+    forward_.dst = b;
+    backward_.src = b;
+    backward_.dst = a;
+}
+
+TcpRelay::~TcpRelay()
+{
+    // 连接都关闭以后才会析构，管道里剩下的数据已经没有意义了
+    PipePool &pool = PipePool::current();
+    pool.release(forward_.pipe, forward_.inPipe == 0);
+    pool.release(backward_.pipe, backward_.inPipe == 0);
+}
+
+void TcpRelay::start()
+{
+    loop_->runInLoop(std::bind(&TcpRelay::startInLoop, shared_from_this()));
+}
+
+void TcpRelay::startInLoop()
+{
+    TcpConnectionPtr a = forward_.src.lock();
+    TcpConnectionPtr b = forward_.dst.lock();
+    if (!a || !b || !a->connected() || !b->connected())
+    {
+        LOG_ERROR("TcpRelay::start connection already closed\n");
+        if (a) a->forceClose();
+        if (b) b->forceClose();
+        return;
+    }
+
+    if (useSplice_ && a->getLoop() == b->getLoop() && startSplice(a, b))
+    {
+        spliceMode_ = true;
+    }
+    else
+    {
+        startBuffer(a, b);
+    }
+    LOG_INFO("TcpRelay %s <-> %s %s\n", a->name().c_str(), b->name().c_str(),
+             spliceMode_ ? "splice" : "buffer");
+}
+
+bool TcpRelay::startSplice(const TcpConnectionPtr &a, const TcpConnectionPtr &b)
+{
+    PipePool &pool = PipePool::current();
+    forward_.pipe = pool.acquire();
+    backward_.pipe = pool.acquire();
+    if (!forward_.pipe.valid() || !backward_.pipe.valid())
+    {
+        pool.release(forward_.pipe, true);
+        pool.release(backward_.pipe, true);
+        forward_.pipe = PipePool::Pipe();
+        backward_.pipe = PipePool::Pipe();
+        return false;
+    }
+
+    // 转发开始前已经读进inputBuffer_的数据(比如代理协议头之后的部分)先走普通的send
+    b->send(a->inputBuffer());
+    a->send(b->inputBuffer());
+
+    std::shared_ptr<TcpRelay> self(shared_from_this());
+    TcpConnection::RelayHooks hooksA;
+    hooksA.onReadable = std::bind(&TcpRelay::handleReadable, self, &forward_);
+    hooksA.onWritable = std::bind(&TcpRelay::handleWritable, self, &backward_);
+    hooksA.onClose = std::bind(&TcpRelay::handleClose, self, &forward_, &backward_);
+    a->setRelayHooks(hooksA);
+
+    TcpConnection::RelayHooks hooksB;
+    hooksB.onReadable = std::bind(&TcpRelay::handleReadable, self, &backward_);
+    hooksB.onWritable = std::bind(&TcpRelay::handleWritable, self, &forward_);
+    hooksB.onClose = std::bind(&TcpRelay::handleClose, self, &backward_, &forward_);
+    b->setRelayHooks(hooksB);
+    return true;
+}
+
+// src可读：socket -> 管道，然后尽量发给dst
+void TcpRelay::handleReadable(Direction *d)
+{
+    TcpConnectionPtr src = d->src.lock();
+    TcpConnectionPtr dst = d->dst.lock();
+    if (!src)
+    {
+        return;
+    }
+    if (d->dstClosed || !dst)
+    {
+        discard(d, src);
+        return;
+    }
+
+    ssize_t n = ::splice(src->fd(), nullptr, d->pipe.writeFd, nullptr,
+                         PipePool::current().pipeSize(), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0)
+    {
+        d->inPipe += n;
+        d->bytes += n;
+    }
+    else if (n == 0)
+    {
+        d->eof = true;
+        src->stopRead();
+    }
+    else if (errno == EAGAIN || errno == EINTR)
+    {
+        return;
+    }
+    else
+    {
+        LOG_ERROR("TcpRelay::handleReadable splice from %s error:%d\n", src->name().c_str(), errno);
+        src->forceClose();
+        return;
+    }
+    pump(d, src, dst);
+}
+
+// dst可写：继续发管道里积压的数据
+void TcpRelay::handleWritable(Direction *d)
+{
+    TcpConnectionPtr dst = d->dst.lock();
+    if (!dst)
+    {
+        return;
+    }
+    if (d->dstClosed)
+    {
+        dst->stopWriteWatch();
+        return;
+    }
+    pump(d, d->src.lock(), dst);
+}
+
+void TcpRelay::pump(Direction *d, const TcpConnectionPtr &src, const TcpConnectionPtr &dst)
+{
+    if (!flushPipe(d, dst.get()))
+    {
+        LOG_ERROR("TcpRelay::pump splice to %s error:%d\n", dst->name().c_str(), errno);
+        dst->forceClose();
+        return;
+    }
+
+    if (d->inPipe > 0)
+    {
+        // dst发不动了，停止读src，背压传给src的对端；
+        // outputBuffer_非空时handleWrite发完会回调过来，不用另外关注可写事件
+        if (src && !d->eof)
+        {
+            src->stopRead();
+        }
+        if (dst->outputBuffer()->readableBytes() == 0)
+        {
+            dst->startWriteWatch();
+        }
+        return;
+    }
+
+    dst->stopWriteWatch();
+    if (d->eof)
+    {
+        dst->shutdown();   // 数据都发完了，半关闭，另一个方向继续
+        checkFinished();
+    }
+    else if (src)
+    {
+        src->startRead();
+    }
+}
+
+bool TcpRelay::flushPipe(Direction *d, TcpConnection *dst)
+{
+    while (d->inPipe > 0)
+    {
+        if (dst->outputBuffer()->readableBytes() > 0)
+        {
+            break;   // 先等outputBuffer_里的数据发完，保证字节顺序
+        }
+        ssize_t n = ::splice(d->pipe.readFd, nullptr, dst->fd(), nullptr,
+                             d->inPipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0)
+        {
+            d->inPipe -= n;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n < 0 && errno == EAGAIN)
+        {
+            break;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 对端已经关闭，读出来丢掉，直到src自己结束
+void TcpRelay::discard(Direction *d, const TcpConnectionPtr &src)
+{
+    int savedErrno = 0;
+    Buffer *buf = src->inputBuffer();
+    ssize_t n = buf->readFd(src->fd(), &savedErrno);
+    buf->retrieveAll();
+    if (n == 0 || (n < 0 && savedErrno != EAGAIN && savedErrno != EINTR))
+    {
+        d->eof = true;
+        src->stopRead();
+        checkFinished();
+    }
+}
+
+// out: 关闭的连接作为src的方向；in: 关闭的连接作为dst的方向
+void TcpRelay::handleClose(Direction *out, Direction *in)
+{
+    out->eof = true;
+    in->dstClosed = true;
+    TcpConnectionPtr peer = out->dst.lock();
+    if (peer && !out->dstClosed)
+    {
+        pump(out, nullptr, peer);   // 管道里剩下的数据发给对端，发完后半关闭
+    }
+    checkFinished();
+}
+
+void TcpRelay::checkFinished()
+{
+    if (finished_ || !forward_.done() || !backward_.done())
+    {
+        return;
+    }
+    finished_ = true;
+    // 两个方向都结束了，已经shutdown过的连接数据都在内核发送队列里，直接关闭不会丢数据
+    TcpConnectionPtr a = forward_.src.lock();
+    TcpConnectionPtr b = forward_.dst.lock();
+    if (a) a->forceClose();
+    if (b) b->forceClose();
+}
+
+void TcpRelay::startBuffer(const TcpConnectionPtr &a, const TcpConnectionPtr &b)
+{
+    // 回调只能在连接自己的loop中替换
+    a->getLoop()->runInLoop(
+        std::bind(&TcpRelay::attachBuffer, shared_from_this(), a, std::weak_ptr<TcpConnection>(b), &forward_));
+    b->getLoop()->runInLoop(
+        std::bind(&TcpRelay::attachBuffer, shared_from_this(), b, std::weak_ptr<TcpConnection>(a), &backward_));
+}
+
+void TcpRelay::attachBuffer(const TcpConnectionPtr &conn, const std::weak_ptr<TcpConnection> &peer, Direction *out)
+{
+    using namespace std::placeholders;
+    std::shared_ptr<TcpRelay> self(shared_from_this());
+    conn->setMessageCallback(std::bind(&TcpRelay::onBufferMessage, self, peer, out, _1, _2, _3));
+    // conn是对端发送数据的目的地：conn发不动时停止读peer
+    conn->setHighWaterMarkCallback(std::bind(&TcpRelay::onBufferHighWaterMark, self, peer), highWaterMark_);
+    conn->setWriteCompleteCallback(std::bind(&TcpRelay::onBufferWriteComplete, self, peer));
+    TcpConnection::RelayHooks hooks;
+    hooks.onClose = std::bind(&TcpRelay::onBufferClose, self, peer);
+    conn->setRelayHooks(hooks);
+
+    Buffer *buf = conn->inputBuffer();
+    if (buf->readableBytes() > 0)
+    {
+        onBufferMessage(peer, out, conn, buf, Timestamp::now());
+    }
+}
+
+void TcpRelay::onBufferMessage(const std::weak_ptr<TcpConnection> &peer, Direction *out,
+                               const TcpConnectionPtr &, Buffer *buf, Timestamp)
+{
+    TcpConnectionPtr p = peer.lock();
+    if (p && p->connected())
+    {
+        out->bytes += buf->readableBytes();
+        p->send(buf);
+    }
+    else
+    {
+        buf->retrieveAll();
+    }
+}
+
+void TcpRelay::onBufferHighWaterMark(const std::weak_ptr<TcpConnection> &peer)
+{
+    TcpConnectionPtr p = peer.lock();
+    if (p)
+    {
+        p->stopRead();
+    }
+}
+
+void TcpRelay::onBufferWriteComplete(const std::weak_ptr<TcpConnection> &peer)
+{
+    TcpConnectionPtr p = peer.lock();
+    if (p && !p->isReading())
+    {
+        p->startRead();
+    }
+}
+
+void TcpRelay::onBufferClose(const std::weak_ptr<TcpConnection> &peer)
+{
+    TcpConnectionPtr p = peer.lock();
+    if (p)
+    {
+        p->shutdown();   // outputBuffer_发完后半关闭
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "PipePool.h"
+#include "Timestamp.h"
+
+class EventLoop;
+class Buffer;
+
+/**
+ * 把两条TcpConnection配对，双向转发字节流，用于四层代理
+ *
+ * 两条连接在同一个loop上时走splice：socket -> 管道 -> socket，数据不进用户态，
+ * 管道从PipePool中取。对端发不动时(splice返回EAGAIN)停止读源端，等对端可写再继续，
+ * 每个方向积压的数据最多一个管道。
+ *
+ * 不在同一个loop上、或者拿不到管道时回退到Buffer：messageCallback里send给对端，
+ * 对端outputBuffer_超过高水位时停止读源端，发完(writeCompleteCallback)后恢复。
+ *
+ * 一端读到EOF且数据发完后半关闭另一端，两个方向都结束后关闭两条连接；
+ * 一端异常关闭时另一端的数据读出来丢掉，等它自己结束。
+ * 转发会接管两条连接的messageCallback等回调，TcpRelay由连接持有，不需要用户保存。
+ * */
+class TcpRelay : noncopyable, public std::enable_shared_from_this<TcpRelay>
+{
+public:
+    static const size_t kDefaultHighWaterMark = 1024 * 1024;
+
+    // 两条连接都必须已经建立
+    TcpRelay(const TcpConnectionPtr &a,
+             const TcpConnectionPtr &b,
+             size_t highWaterMark = kDefaultHighWaterMark);
+    ~TcpRelay();
+
+    void setSplice(bool on) { useSplice_ = on; }   // 关闭后总是走Buffer，start之前设置
+    void start();   // 线程安全
+
+    bool spliceMode() const { return spliceMode_; }
+    int64_t bytesForward() const { return forward_.bytes; }    // a -> b
+    int64_t bytesBackward() const { return backward_.bytes; }  // b -> a
+
+private:
+    // 一个方向的转发状态，splice模式下只在loop线程中访问
+    struct Direction
+    {
+        std::weak_ptr<TcpConnection> src;
+        std::weak_ptr<TcpConnection> dst;
+        PipePool::Pipe pipe;
+        size_t inPipe = 0;         // 管道中还没发给dst的字节
+        bool eof = false;          // src已经读到EOF或者关闭了
+        bool dstClosed = false;    // dst已经关闭，src的数据读出来丢掉
+        std::atomic<int64_t> bytes{0};
+
+        bool done() const { return eof && (inPipe == 0 || dstClosed); }
+    };
+
+    void startInLoop();
+    bool startSplice(const TcpConnectionPtr &a, const TcpConnectionPtr &b);
+    void startBuffer(const TcpConnectionPtr &a, const TcpConnectionPtr &b);
+
+    // splice模式
+    void handleReadable(Direction *d);
+    void handleWritable(Direction *d);
+    void handleClose(Direction *out, Direction *in);
+    void pump(Direction *d, const TcpConnectionPtr &src, const TcpConnectionPtr &dst);
+    bool flushPipe(Direction *d, TcpConnection *dst);
+    void discard(Direction *d, const TcpConnectionPtr &src);
+    void checkFinished();
+
+    // Buffer模式，在conn所在loop中执行
+    void attachBuffer(const TcpConnectionPtr &conn, const std::weak_ptr<TcpConnection> &peer, Direction *out);
+    void onBufferMessage(const std::weak_ptr<TcpConnection> &peer, Direction *out,
+                         const TcpConnectionPtr &conn, Buffer *buf, Timestamp time);
+    void onBufferHighWaterMark(const std::weak_ptr<TcpConnection> &peer);
+    void onBufferWriteComplete(const std::weak_ptr<TcpConnection> &peer);
+    void onBufferClose(const std::weak_ptr<TcpConnection> &peer);
+
+    EventLoop *loop_;   // a所在的loop
+    const size_t highWaterMark_;
+    bool useSplice_;
+    bool spliceMode_;
+    bool finished_;
+    Direction forward_;    // a -> b
+    Direction backward_;   // b -> a
+};
@@ -4,6 +4,7 @@
 #include "TcpServer.h"
 #include "Logger.h"
 #include "TcpConnection.h"
+#include "SlabPool.h"
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -14,40 +15,97 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
     return loop;
 }
 
+// unix域socket没有SO_REUSEPORT的分流，每个loop的Acceptor还会删掉前一个绑定的文件重新bind，
+// 最后只有一个loop能accept，改为所有loop共用一个listen socket
+static TcpServer::Option checkOption(TcpServer::Option option, const InetAddress &listenAddr)
+{
+    if (option == TcpServer::kReusePortPerLoop && listenAddr.isUnixDomain())
+    {
+        LOG_INFO("TcpServer - kReusePortPerLoop is not supported on %s, using kExclusiveAccept\n",
+                 listenAddr.toIpPort().c_str());
+        return TcpServer::kExclusiveAccept;
+    }
+    return option;
+}
+
 TcpServer::TcpServer(EventLoop *loop,   // 用户态传递来的loop
                      const InetAddress &listenAddr,
                      const std::string &nameArg,
-                     Option option)
+                     Option option,
+                     Ipv6Option ipv6Option)
     : loop_(CheckLoopNotNull(loop))  // 初始化tcpserver所属的loop(eventloop)
     , ipPort_(listenAddr.toIpPort())   // ip端口所组成的字符串
     , name_(nameArg)
+    , connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_ + "#"))
+    , listenAddr_(listenAddr)
+    , option_(checkOption(option, listenAddr))
+    , ipv6Only_(ipv6Option == kIpv6Only)
         // 我们把传来的loop给了acceptor的构造函数，所以acceptor的loop_就是指向用户态传递的loop
-    , acceptor_(new Acceptor(loop, listenAddr, option == kReusePort))
+    , acceptor_(option_ == kReusePortPerLoop ? nullptr
+                                             : new Acceptor(loop, listenAddr, option_ == kReusePort, ipv6Only_))
     , threadPool_(new EventLoopThreadPool(loop, name_))
     , connectionCallback_()   // 留给上层用户进行初始化
     , messageCallback_()      // 留给上层用户进行初始化
     , nextConnId_(1)      // 创建连接时候会用到
     , started_(0)
+    , tcpInfoSampleIntervalMs_(0)
+    , busyPollSpinUs_(0)
+    , socketBusyPollUs_(0)
 {
     // 当有新用户连接时，Acceptor类中绑定的acceptChannel_会有读事件发生，执行handleRead()调用TcpServer::newConnection回调
     //使用两个占位符，因为tcpserver::newConection方法需要新用户的confd以及ip port
-    acceptor_->setNewConnectionCallback(
-        std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    if (option_ == kNoReusePort || option_ == kReusePort)
+    {
+        acceptor_->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    }
 }
 
 TcpServer::~TcpServer()
 {
-    for(auto &item : connections_)
+    for (auto &item : tcpInfoSamplers_)
     {
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();    // 把原始的智能指针复位 让栈空间的TcpConnectionPtr conn指向该对象 当conn出了其作用域 即可释放智能指针指向的对象
-        // 销毁连接
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn));
+        // 采样器的定时器在各自的loop中，需要到所属loop中停止
+        item.first->runInLoop(std::bind(&TcpInfoSampler::stop, item.second));
+    }
+    for (auto &item : connectionTables_)
+    {
+        // 连接表只能在所属loop中访问，到所属loop中销毁其上的所有连接
+        item.first->runInLoop(std::bind(&TcpServer::destroyConnectionsInLoop, item.second));
     }
 }
 
 // 设置底层subloop的个数
+void TcpServer::setConnectionCallback(const ConnectionCallback &cb)
+{
+    if (started_ > 0)
+    {
+        LOG_ERROR("TcpServer [%s] setConnectionCallback after start() is ignored \n", name_.c_str());
+        return;
+    }
+    connectionCallback_ = cb;
+}
+
+void TcpServer::setMessageCallback(const MessageCallback &cb)
+{
+    if (started_ > 0)
+    {
+        LOG_ERROR("TcpServer [%s] setMessageCallback after start() is ignored \n", name_.c_str());
+        return;
+    }
+    messageCallback_ = cb;
+}
+
+void TcpServer::setWriteCompleteCallback(const WriteCompleteCallback &cb)
+{
+    if (started_ > 0)
+    {
+        LOG_ERROR("TcpServer [%s] setWriteCompleteCallback after start() is ignored \n", name_.c_str());
+        return;
+    }
+    writeCompleteCallback_ = cb;
+}
+
 void TcpServer::setThreadNum(int numThreads)
 {
     threadPool_->setThreadNum(numThreads);
@@ -60,9 +118,52 @@ void TcpServer::start()
     if (started_++ == 0)    // 防止一个TcpServer对象被start多次
     {
         threadPool_->start(threadInitCallback_);    // 启动底层的loop线程池
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));  // tcpserver的loop_指向的是当前主loop
-        // listen绑定到主loop，检测是否有事件发生
-        // 有事件发生，则分发给子loop
+        bool acceptInLoops = option_ == kReusePortPerLoop || option_ == kExclusiveAccept;
+        std::shared_ptr<std::atomic<int64_t>> nextSequence = std::make_shared<std::atomic<int64_t>>(1);
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            // 用户的回调在start之前设置，这里给每个loop拷贝一份，subloop建立连接时不再访问TcpServer
+            ConnectionTablePtr table = std::make_shared<ConnectionTable>(ioLoop);
+            table->namePrefix = connNamePrefix_;
+            table->connectionCallback = connectionCallback_;
+            table->messageCallback = messageCallback_;
+            table->writeCompleteCallback = writeCompleteCallback_;
+            table->socketBusyPollUs = socketBusyPollUs_;
+            if (busyPollSpinUs_ > 0)
+            {
+                ioLoop->setBusyPoll(busyPollSpinUs_);
+            }
+            if (tcpInfoSampleIntervalMs_ > 0)
+            {
+                std::shared_ptr<TcpInfoSampler> sampler(new TcpInfoSampler(ioLoop, tcpInfoSampleIntervalMs_));
+                tcpInfoSamplers_[ioLoop] = sampler;
+                table->sampler = sampler;
+                sampler->start();
+            }
+            connectionTables_[ioLoop] = table;
+            if (acceptInLoops)
+            {
+                table->nextSequence = nextSequence;
+                if (option_ == kReusePortPerLoop)
+                {
+                    table->acceptor.reset(new Acceptor(ioLoop, listenAddr_, true, ipv6Only_));
+                }
+                else
+                {
+                    table->acceptor.reset(new Acceptor(ioLoop, *acceptor_));
+                }
+                table->acceptor->setNewConnectionCallback(
+                    std::bind(&TcpServer::acceptInLoop, std::weak_ptr<ConnectionTable>(table),
+                              std::placeholders::_1, std::placeholders::_2));
+                ioLoop->runInLoop(std::bind(&Acceptor::listen, table->acceptor.get()));
+            }
+        }
+        if (!acceptInLoops)
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));  // tcpserver的loop_指向的是当前主loop
+            // listen绑定到主loop，检测是否有事件发生
+            // 有事件发生，则分发给子loop
+        }
     }
 }
 
@@ -73,17 +174,40 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
     // 轮询算法 选择一个subLoop 来管理connfd对应的channel
     EventLoop *ioLoop = threadPool_->getNextLoop();  // 线程池中选择一个subloop   std::vector<EventLoop *> loops_;
-    char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
+    // 连接名不在这里拼接，TcpConnection只持有共享的前缀和序号
+    int64_t sequence = nextConnId_;
     // 表示下一个connection
     ++nextConnId_;  // 这里没有设置为原子类是因为其只在mainloop中执行 不涉及线程安全问题
-    std::string connName = name_ + buf;
 
-    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s\n",
-             name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
+    char peerIpPort[InetAddress::kMaxIpPortLen];   // 格式化到栈上，accept路径上不为日志分配内存
+    peerAddr.formatIpPort(peerIpPort, sizeof peerIpPort);
+    LOG_INFO("TcpServer::newConnection [%s] - new connection [%s%lld] from %s\n",
+             name_.c_str(), connNamePrefix_->c_str(), static_cast<long long>(sequence), peerIpPort);
     
+    // 连接对象在subloop中创建，从subloop自己的内存池分配，销毁时也回到这个池
+    ioLoop->runInLoop(
+        std::bind(&TcpServer::newConnectionInLoop, connectionTables_[ioLoop], sockfd, peerAddr, sequence));
+    // runInLoop 执行cb,把newConnectionInLoop丢进pendingFunctors_，由subloop创建连接并加入连接表
+}
+
+void TcpServer::acceptInLoop(const std::weak_ptr<ConnectionTable> &weakTable, int sockfd, const InetAddress &peerAddr)
+{
+    // Acceptor归连接表所有，回调执行时连接表一定还在
+    ConnectionTablePtr table = weakTable.lock();
+    int64_t sequence = table->nextSequence->fetch_add(1, std::memory_order_relaxed);
+
+    char peerIpPort[InetAddress::kMaxIpPortLen];
+    peerAddr.formatIpPort(peerIpPort, sizeof peerIpPort);
+    LOG_INFO("TcpServer::acceptInLoop - new connection [%s%lld] from %s\n",
+             table->namePrefix->c_str(), static_cast<long long>(sequence), peerIpPort);
+
+    newConnectionInLoop(table, sockfd, peerAddr, sequence);
+}
+
+void TcpServer::newConnectionInLoop(const ConnectionTablePtr &table, int sockfd, const InetAddress &peerAddr, int64_t sequence)
+{
     // 通过sockfd获取其绑定的本机的ip地址和端口信息
-    sockaddr_in local;
+    sockaddr_storage local;   // ipv4或者unix域socket的地址
     ::memset(&local, 0, sizeof(local));
     socklen_t addrlen = sizeof(local);
     // getsockname  调用成功返回0  出错返回-1
@@ -93,43 +217,83 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
         LOG_ERROR("sockets::getLocalAddr");
     }
 
-    InetAddress localAddr(local);   // 设置本地地址
+    InetAddress localAddr((sockaddr *)&local, addrlen);   // 设置本地地址
     // 创建一个TcpConnection对象，并设置相应的上层回调，这里的回调是由  用户->tcpserver->这里
-    TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                            connName,
-                                            sockfd,
-                                            localAddr,
-                                            peerAddr));
-    connections_[connName] = conn;   // 连接加入哈希表
+    // allocate_shared让shared_ptr的控制块和TcpConnection在内存池的同一个块中
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(PoolAllocator<TcpConnection>(),
+                                                                table->loop,
+                                                                table->namePrefix,
+                                                                sequence,
+                                                                sockfd,
+                                                                localAddr,
+                                                                peerAddr);
     // 下面的回调都是用户设置给TcpServer => TcpConnection的，
     // 至于Channel绑定的则是TcpConnection设置的四个，handleRead,handleWrite... 这下面的回调用于handlexxx函数中
-    conn->setConnectionCallback(connectionCallback_);
-    conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setConnectionCallback(table->connectionCallback);
+    conn->setMessageCallback(table->messageCallback);
+    conn->setWriteCompleteCallback(table->writeCompleteCallback);
+    if (table->socketBusyPollUs > 0)
+    {
+        conn->setBusyPoll(table->socketBusyPollUs);
+    }
 
-    // 设置了如何关闭连接的回调
+    // 设置了如何关闭连接的回调，关闭时只需要访问subloop自己的连接表
     conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+        std::bind(&TcpServer::removeConnection, table, std::placeholders::_1));
 
-    ioLoop->runInLoop(
-        std::bind(&TcpConnection::connectEstablished, conn));
-    // runInLoop 执行cb,把connectEstablished丢进pendingFunctors_
+    conn->setId(table->connections.insert(conn));   // id在所属loop内唯一
+    table->count.store(table->connections.size(), std::memory_order_relaxed);
+    conn->connectEstablished();
+
+    if (table->sampler)
+    {
+        table->sampler->addConnection(conn);   // 断开的连接在采样时自动移除
+    }
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+std::vector<TcpInfoStats> TcpServer::tcpInfoStats() const
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn));
-    // runInLoop 执行cb，把removeConnectionInLoop丢进pendingFunctors_
+    std::vector<TcpInfoStats> result;
+    for (const auto &item : tcpInfoSamplers_)
+    {
+        result.push_back(item.second->stats());
+    }
+    return result;
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+size_t TcpServer::numConnections() const
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
-             name_.c_str(), conn->name().c_str());
+    size_t n = 0;
+    for (const auto &item : connectionTables_)
+    {
+        n += item.second->count.load(std::memory_order_relaxed);
+    }
+    return n;
+}
 
-    connections_.erase(conn->name());  // 哈希表中对应的连接移除
-    EventLoop *ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(
+// 由TcpConnection::handleClose在连接所属的loop中调用，不再绕道baseloop
+void TcpServer::removeConnection(const ConnectionTablePtr &table, const TcpConnectionPtr &conn)
+{
+    char connName[TcpConnection::kMaxNameLen];
+    conn->formatName(connName, sizeof connName);
+    LOG_INFO("TcpServer::removeConnection - connection %s\n", connName);
+
+    table->connections.erase(conn->id());  // 连接表中对应的连接移除
+    table->count.store(table->connections.size(), std::memory_order_relaxed);
+    // 还在Channel::handleEvent中，销毁放到这一轮事件处理之后
+    table->loop->queueInLoop(
         std::bind(&TcpConnection::connectDestroyed, conn));    // 丢入loop的丢进pendingFunctors_
-}
\ No newline at end of file
+}
+
+void TcpServer::destroyConnectionsInLoop(const ConnectionTablePtr &table)
+{
+    table->acceptor.reset();   // 先停止accept，之后不会再有新连接加入
+    table->connections.forEach([](ConnectionMap::Id, TcpConnectionPtr &item) {
+        TcpConnectionPtr conn(item);
+        item.reset();    // 把原始的智能指针复位 让栈空间的TcpConnectionPtr conn指向该对象 当conn出了其作用域 即可释放智能指针指向的对象
+        // 销毁连接
+        conn->connectDestroyed();
+    });
+    table->connections.clear();
+    table->count.store(0, std::memory_order_relaxed);
+}
@@ -9,6 +9,7 @@
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
 
 #include "EventLoop.h"
 #include "Acceptor.h"
@@ -18,6 +19,8 @@
 #include "Callbacks.h"
 #include "TcpConnection.h"
 #include "Buffer.h"
+#include "TcpInfoSampler.h"
+#include "SlotMap.h"
 
 // 对外的服务器编程使用的类
 class TcpServer
@@ -25,16 +28,28 @@ class TcpServer
 public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
 
-    enum Option   // 0和1
+    enum Option
     {
         kNoReusePort,
         kReusePort,
+        // 下面两种由subloop自己accept，新连接直接在accept它的loop中建立，不经过baseloop转交
+        kReusePortPerLoop,   // 每个loop一个SO_REUSEPORT的listen socket，内核按四元组哈希选socket，loop数变化时重新哈希
+                             // 只支持ip地址，unix域地址时改用kExclusiveAccept
+        kExclusiveAccept,    // 一个listen socket以EPOLLEXCLUSIVE注册到每个loop，由正在等待的空闲loop接走新连接
+    };
+
+    // 监听ipv6地址时是否同时接受ipv4连接
+    enum Ipv6Option
+    {
+        kDualStack,
+        kIpv6Only,
     };
 
     TcpServer(EventLoop *loop,
               const InetAddress &listenAddr,
               const std::string &nameArg,
-              Option option = kNoReusePort);
+              Option option = kNoReusePort,
+              Ipv6Option ipv6Option = kDualStack);
     ~TcpServer();
 
     // 这些cb都是用户自定义的
@@ -42,31 +57,83 @@ public:
     // server_.setConnectionCallback
     // server_.setMessageCallback
     // 这些自定义的回调，将用户设置的回调传递给Tcpserver，然后TcpServer在创建新的连接的时候，传递给TcpConnection
+    // 必须在start之前设置：start时会给每个loop的连接表拷贝一份，之后再设置不会生效(会打LOG_ERROR)
     void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
-    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
-    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
-    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setConnectionCallback(const ConnectionCallback &cb);
+    void setMessageCallback(const MessageCallback &cb);
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb);
 
     // 设置底层subloop的个数
     void setThreadNum(int numThreads);  // 每个thread有一个自己的loop，因此线程数量和eventloop对应
     // 主线程在接收一个新连接的时候，会创建一个TcpConnection对象，并将这个对象对应的eventloop指向一个新的eventloop
 
+    // 每个loop每隔intervalMs毫秒采样一次其上所有连接的TCP_INFO，需要在start之前设置，0表示不采样
+    void setTcpInfoSampleInterval(int intervalMs) { tcpInfoSampleIntervalMs_ = intervalMs; }
+
+    // 低延迟模式，需要在start之前设置：loopSpinUs设置给每个subloop(EventLoop::setBusyPoll)，
+    // socketBusyPollUs不为0时给每个新连接设置SO_BUSY_POLL
+    void setBusyPoll(int loopSpinUs, int socketBusyPollUs = 0)
+    { busyPollSpinUs_ = loopSpinUs; socketBusyPollUs_ = socketBusyPollUs; }
+    // 每个loop最近一次的采样结果
+    std::vector<TcpInfoStats> tcpInfoStats() const;
+
+    // 所有loop上当前的连接数之和，任意线程都可以调用
+    size_t numConnections() const;
+
     // 开启服务器监听
     void start();
 
+    // start之后可以通过threadPool()->getAllLoops()获取所有的loop
+    std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
+
 private:
-    void newConnection(int sockfd, const InetAddress &peerAddr);
-    void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    // 连接id(代数+下标)到TcpConnection对象的指针，增删都不需要格式化和哈希连接名
+    using ConnectionMap = SlotMap<TcpConnectionPtr>;
+
+    /**
+     * 每个loop一张连接表，只在所属loop线程中增删，连接的建立和销毁都不经过baseloop
+     * 连接的closeCallback只持有连接表，不持有TcpServer
+     * */
+    struct ConnectionTable
+    {
+        explicit ConnectionTable(EventLoop *loopArg) : loop(loopArg), count(0) {}
+        EventLoop *loop;
+        ConnectionMap connections;
+        std::atomic<size_t> count;   // connections的大小，给其他线程读
+        // 下面的在start时设置，之后只读
+        std::shared_ptr<const std::string> namePrefix;
+        ConnectionCallback connectionCallback;
+        MessageCallback messageCallback;
+        WriteCompleteCallback writeCompleteCallback;
+        std::shared_ptr<TcpInfoSampler> sampler;
+        int socketBusyPollUs = 0;
+        // kReusePortPerLoop和kExclusiveAccept时这个loop自己的Acceptor，销毁连接表时在所属loop中释放
+        std::unique_ptr<Acceptor> acceptor;
+        std::shared_ptr<std::atomic<int64_t>> nextSequence;   // 所有loop共用的连接序号
+    };
+    using ConnectionTablePtr = std::shared_ptr<ConnectionTable>;
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;  // 当前连接的名称和对应的TcpConnection对象的指针
+    void newConnection(int sockfd, const InetAddress &peerAddr);
+    // 所属loop的Acceptor直接accept到新连接，连接表由Acceptor的回调持有，用weak_ptr避免循环引用
+    static void acceptInLoop(const std::weak_ptr<ConnectionTable> &weakTable, int sockfd, const InetAddress &peerAddr);
+    // 下面三个都在连接表所属的loop中执行
+    static void newConnectionInLoop(const ConnectionTablePtr &table, int sockfd, const InetAddress &peerAddr, int64_t sequence);
+    static void removeConnection(const ConnectionTablePtr &table, const TcpConnectionPtr &conn);
+    static void destroyConnectionsInLoop(const ConnectionTablePtr &table);
 
     EventLoop *loop_; // baseloop 用户自定义的 loop， TcpServer对应的loop
 
     const std::string ipPort_;  // ip端口
     const std::string name_;   // 名称
+    // 连接名的公共前缀"name-ip:port#"，所有连接共享一份，连接名在用到时才拼上序号
+    const std::shared_ptr<const std::string> connNamePrefix_;
+
+    const InetAddress listenAddr_;
+    const Option option_;
+    const bool ipv6Only_;
 
-    std::unique_ptr<Acceptor> acceptor_; // 运行在mainloop 任务就是监听新连接事件
+    // 运行在mainloop 任务就是监听新连接事件。kExclusiveAccept时只持有被各个loop共用的listen socket，kReusePortPerLoop时为空
+    std::unique_ptr<Acceptor> acceptor_;
 
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per thread
 
@@ -78,6 +145,13 @@ private:
 
     std::atomic_int started_;  // 原子类型，进行原子操作   线程启动时会进行计数，防止tcpserver启动多次
 
-    int nextConnId_;
-    ConnectionMap connections_; // 保存所有的连接
+    int64_t nextConnId_;
+    // 每个loop一张连接表，start之后不再修改，TcpServer看到的所有连接是这些表的汇总
+    std::unordered_map<EventLoop *, ConnectionTablePtr> connectionTables_;
+
+    int tcpInfoSampleIntervalMs_;
+    int busyPollSpinUs_;
+    int socketBusyPollUs_;
+    // 每个loop一个采样器，start之后不再修改
+    std::unordered_map<EventLoop *, std::shared_ptr<TcpInfoSampler>> tcpInfoSamplers_;
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#include <time.h>
+
+#include "Timer.h"
+
+std::atomic<int64_t> Timer::numCreated_(0);
+
+int64_t Timer::nowMicros()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+
+#include "nonCopyable.h"
+
+// 定时器的唯一标识，使用定时器创建时的序号
+using TimerId = int64_t;
+
+/**
+ * 定时器
+ * 到期时间使用 CLOCK_MONOTONIC 的微秒数表示，不受系统时间调整的影响
+ * intervalUs > 0 表示周期定时器
+ * */
+class Timer : nonCopyable
+{
+public:
+    using TimerCallback = std::function<void()>;
+
+    Timer(TimerCallback cb, int64_t when, int64_t intervalUs)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(intervalUs)
+        , repeat_(intervalUs > 0)
+        , sequence_(++numCreated_)
+    {
+    }
+
+    void run() const { callback_(); }   // 执行定时器回调
+
+    int64_t expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    TimerId sequence() const { return sequence_; }
+
+    // 周期定时器到期后，以now为起点重新计算下一次的到期时间
+    void restart(int64_t now) { expiration_ = now + interval_; }
+
+    // 当前的单调时钟，单位微秒
+    static int64_t nowMicros();
+
+private:
+    const TimerCallback callback_;
+    int64_t expiration_;   // 到期时间
+    const int64_t interval_;   // 周期，单位微秒
+    const bool repeat_;
+    const TimerId sequence_;
+
+    static std::atomic<int64_t> numCreated_;   // 用于生成定时器序号
+};
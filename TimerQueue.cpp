@@ -0,0 +1,157 @@
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "TimerQueue.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+static int createTimerfd()
+{
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0)
+    {
+        LOG_FATAL("timerfd_create error:%d\n", errno);
+    }
+    return timerfd;
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+    , callingExpiredTimers_(false)
+{
+    timerfdChannel_.setReadCallback(
+        std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.enableReading();   // 和wakeupChannel_一样，一直关注timerfd的读事件
+}
+
+TimerQueue::~TimerQueue()
+{
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+}
+
+TimerId TimerQueue::addTimer(Timer::TimerCallback cb, int64_t when, int64_t intervalUs)
+{
+    Timer *timer = new Timer(std::move(cb), when, intervalUs);
+    // 交给loop之后timer可能已经到期并被删除(其他线程中调用runAfter(0)时最明显)，先取出id
+    TimerId id = timer->sequence();
+    // timers_只在loop线程中修改，所以放到loop中执行，Timer的所有权在addTimerInLoop中交给activeTimers_
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return id;
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer)
+{
+    bool earliestChanged = timers_.empty() || timer->expiration() < timers_.begin()->first;
+    timers_.insert(Entry(timer->expiration(), timer->sequence()));
+    activeTimers_[timer->sequence()].reset(timer);
+
+    if (earliestChanged)   // 新加的定时器最早到期，需要重新设置timerfd
+    {
+        resetTimerfd(timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    auto it = activeTimers_.find(timerId);
+    if (it == activeTimers_.end())
+    {
+        return;
+    }
+    if (timers_.erase(Entry(it->second->expiration(), timerId)) > 0)
+    {
+        activeTimers_.erase(it);
+    }
+    else if (callingExpiredTimers_)
+    {
+        // 定时器已经到期，正在执行回调(可能就是在自己的回调里取消自己)，等回调执行完再删除
+        cancelingTimers_.insert(timerId);
+    }
+}
+
+void TimerQueue::handleRead()
+{
+    uint64_t howmany = 0;
+    ssize_t n = ::read(timerfd_, &howmany, sizeof howmany);  // 读走到期次数，否则LT模式下会一直触发
+    if (n != sizeof howmany)
+    {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8\n", n);
+    }
+
+    int64_t now = Timer::nowMicros();
+
+    // 取出所有到期的定时器，序号都大于0，所以(now + 1, 0)之前的都是到期时间 <= now 的定时器
+    std::vector<TimerId> expired;
+    TimerList::iterator end = timers_.lower_bound(Entry(now + 1, 0));
+    for (TimerList::iterator it = timers_.begin(); it != end; ++it)
+    {
+        expired.push_back(it->second);
+    }
+    timers_.erase(timers_.begin(), end);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (TimerId id : expired)
+    {
+        auto it = activeTimers_.find(id);
+        if (it != activeTimers_.end())
+        {
+            it->second->run();
+        }
+    }
+    callingExpiredTimers_ = false;
+
+    // 周期定时器重新加入队列，一次性定时器和回调中被取消的定时器直接删除
+    for (TimerId id : expired)
+    {
+        auto it = activeTimers_.find(id);
+        if (it == activeTimers_.end())
+        {
+            continue;
+        }
+        Timer *timer = it->second.get();
+        if (timer->repeat() && cancelingTimers_.find(id) == cancelingTimers_.end())
+        {
+            timer->restart(now);
+            timers_.insert(Entry(timer->expiration(), id));
+        }
+        else
+        {
+            activeTimers_.erase(it);
+        }
+    }
+
+    if (!timers_.empty())
+    {
+        resetTimerfd(timers_.begin()->first);
+    }
+}
+
+void TimerQueue::resetTimerfd(int64_t expiration)
+{
+    int64_t microseconds = expiration - Timer::nowMicros();
+    if (microseconds < 100)   // 已经到期的定时器也至少等待100us，it_value为0会停止timerfd
+    {
+        microseconds = 100;
+    }
+
+    struct itimerspec newValue;
+    ::memset(&newValue, 0, sizeof newValue);
+    newValue.it_value.tv_sec = static_cast<time_t>(microseconds / (1000 * 1000));
+    newValue.it_value.tv_nsec = static_cast<long>((microseconds % (1000 * 1000)) * 1000);
+    if (::timerfd_settime(timerfd_, 0, &newValue, nullptr) < 0)
+    {
+        LOG_ERROR("timerfd_settime error:%d\n", errno);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <set>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "nonCopyable.h"
+#include "Timer.h"
+#include "Channel.h"
+
+class EventLoop;
+
+/**
+ * 定时器队列
+ * 所有定时器共用一个timerfd，timerfd的到期时间总是设置为最早到期的那个定时器
+ * timerfd 和 wakeupFd_ 一样，被封装成Channel注册到EventLoop的Poller上
+ * 定时器到期 => timerfd可读 => handleRead => 执行所有到期定时器的回调
+ * */
+class TimerQueue : nonCopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 添加定时器，可以跨线程调用，when为单调时钟的微秒数
+    TimerId addTimer(Timer::TimerCallback cb, int64_t when, int64_t intervalUs);
+    // 取消定时器，可以跨线程调用
+    void cancel(TimerId timerId);
+
+private:
+    // 按到期时间排序，到期时间相同时按序号区分
+    using Entry = std::pair<int64_t, TimerId>;
+    using TimerList = std::set<Entry>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd 可读时的回调
+    void handleRead();
+    // 把timerfd的到期时间设置为expiration
+    void resetTimerfd(int64_t expiration);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    TimerList timers_;   // 等待到期的定时器
+    std::unordered_map<TimerId, std::unique_ptr<Timer>> activeTimers_;   // 所有未被删除的定时器
+
+    bool callingExpiredTimers_;    // 是否正在执行到期定时器的回调
+    std::set<TimerId> cancelingTimers_;   // 在回调执行过程中被取消的定时器
+};
@@ -0,0 +1,287 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "UdpChannel.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+static int createNonblockingUdp(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d udp socket create err:%d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+UdpChannel::UdpChannel(EventLoop *loop,
+                       const InetAddress &localAddr,
+                       const std::string &name,
+                       bool reusePort,
+                       int batchSize,
+                       size_t maxDatagramSize)
+    : loop_(loop)
+    , name_(name)
+    , localAddr_(localAddr)
+    , socket_(createNonblockingUdp(localAddr.family()))
+    , channel_(new Channel(loop, socket_.fd()))
+    , batchSize_(batchSize > 0 ? batchSize : 1)
+    , maxDatagramSize_(maxDatagramSize)
+    , recvBuffer_(batchSize_ * maxDatagramSize_)
+    , recvIovecs_(batchSize_)
+    , recvAddrs_(batchSize_)
+    , recvMsgs_(batchSize_)
+    , registered_(false)
+    , sendHead_(0)
+    , handlingRead_(false)
+    , flushQueued_(false)
+    , sendIovecs_(batchSize_)
+    , sendMsgs_(batchSize_)
+    , datagramsReceived_(0)
+    , datagramsSent_(0)
+    , recvCalls_(0)
+    , sendCalls_(0)
+    , truncated_(0)
+    , dropped_(0)
+{
+    socket_.setReuseAddr(true);
+    socket_.setReusePort(reusePort);
+    socket_.bindAddress(localAddr);
+
+    ::memset(recvMsgs_.data(), 0, recvMsgs_.size() * sizeof(struct mmsghdr));
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        recvIovecs_[i].iov_base = &recvBuffer_[i * maxDatagramSize_];
+        recvIovecs_[i].iov_len = maxDatagramSize_;
+        struct msghdr &hdr = recvMsgs_[i].msg_hdr;
+        hdr.msg_name = &recvAddrs_[i];
+        hdr.msg_namelen = sizeof(sockaddr_in6);
+        hdr.msg_iov = &recvIovecs_[i];
+        hdr.msg_iovlen = 1;
+    }
+
+    channel_->setReadCallback(
+        std::bind(&UdpChannel::handleRead, this, std::placeholders::_1));
+    channel_->setWriteCallback(
+        std::bind(&UdpChannel::handleWrite, this));
+}
+
+UdpChannel::~UdpChannel()
+{
+    LOG_INFO("UdpChannel::dtor[%s] at fd=%d\n", name_.c_str(), socket_.fd());
+    if (registered_)
+    {
+        // poller还持有channel_的指针，只能在loop线程中移除
+        if (!loop_->isInLoopThread())
+        {
+            LOG_FATAL("UdpChannel::dtor[%s] - destroyed outside its loop without stop()\n", name_.c_str());
+        }
+        channel_->disableAll();
+        channel_->remove();
+    }
+}
+
+void UdpChannel::setRecvBufferSize(int bytes)
+{
+    if (::setsockopt(socket_.fd(), SOL_SOCKET, SO_RCVBUF, &bytes, sizeof bytes) < 0)
+    {
+        LOG_ERROR("UdpChannel::setRecvBufferSize[%s] errno:%d\n", name_.c_str(), errno);
+    }
+}
+
+void UdpChannel::start()
+{
+    loop_->runInLoop(std::bind(&UdpChannel::startInLoop, shared_from_this()));
+}
+
+void UdpChannel::startInLoop()
+{
+    channel_->tie(shared_from_this());
+    channel_->enableReading();
+    registered_ = true;
+}
+
+void UdpChannel::stop()
+{
+    loop_->runInLoop(std::bind(&UdpChannel::stopInLoop, shared_from_this()));
+}
+
+void UdpChannel::stopInLoop()
+{
+    if (!registered_)
+    {
+        return;
+    }
+    registered_ = false;
+    channel_->disableAll();
+    channel_->remove();
+}
+
+void UdpChannel::handleRead(Timestamp receiveTime)
+{
+    int n = ::recvmmsg(socket_.fd(), recvMsgs_.data(), batchSize_, MSG_DONTWAIT, nullptr);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            LOG_ERROR("UdpChannel::handleRead[%s] recvmmsg errno:%d\n", name_.c_str(), errno);
+        }
+        return;
+    }
+    recvCalls_.fetch_add(1, std::memory_order_relaxed);
+    datagramsReceived_.fetch_add(n, std::memory_order_relaxed);
+
+    UdpChannelPtr self(shared_from_this());
+    int truncated = 0;
+    handlingRead_ = true;
+    for (int i = 0; i < n; ++i)
+    {
+        struct msghdr &hdr = recvMsgs_[i].msg_hdr;
+        if (hdr.msg_flags & MSG_TRUNC)
+        {
+            ++truncated;
+        }
+        else if (datagramCallback_)
+        {
+            InetAddress peer(reinterpret_cast<const sockaddr *>(&recvAddrs_[i]), hdr.msg_namelen);
+            datagramCallback_(self, static_cast<const char *>(recvIovecs_[i].iov_base), recvMsgs_[i].msg_len,
+                              peer, receiveTime);
+        }
+        // 内核会改写这两个字段，下次recvmmsg之前恢复
+        hdr.msg_namelen = sizeof(sockaddr_in6);
+        hdr.msg_flags = 0;
+    }
+    handlingRead_ = false;
+    if (truncated > 0)
+    {
+        truncated_.fetch_add(truncated, std::memory_order_relaxed);
+        LOG_ERROR("UdpChannel::handleRead[%s] %d datagrams larger than %lu dropped\n",
+                  name_.c_str(), truncated, maxDatagramSize_);
+    }
+
+    // 这批数据报的回复一起发出去
+    if (sendHead_ < sendQueue_.size() && !channel_->isWriting())
+    {
+        flushInLoop();
+    }
+}
+
+void UdpChannel::handleWrite()
+{
+    flushInLoop();
+}
+
+void UdpChannel::send(const InetAddress &peer, const void *data, size_t len)
+{
+    if (loop_->isInLoopThread())
+    {
+        sendInLoop(peer, data, len);
+    }
+    else
+    {
+        loop_->runInLoop(
+            std::bind(&UdpChannel::sendStringInLoop, shared_from_this(), peer,
+                      std::string(static_cast<const char *>(data), len)));
+    }
+}
+
+void UdpChannel::send(const InetAddress &peer, const std::string &message)
+{
+    send(peer, message.data(), message.size());
+}
+
+void UdpChannel::sendStringInLoop(const InetAddress &peer, const std::string &message)
+{
+    sendInLoop(peer, message.data(), message.size());
+}
+
+void UdpChannel::sendInLoop(const InetAddress &peer, const void *data, size_t len)
+{
+    if (sendQueue_.size() - sendHead_ >= kMaxPendingDatagrams)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    PendingDatagram datagram;
+    datagram.peerLen = std::min<socklen_t>(peer.getSockLen(), sizeof datagram.peer);
+    ::memcpy(&datagram.peer, peer.getSockAddr(), datagram.peerLen);
+    datagram.data.assign(static_cast<const char *>(data), len);
+    sendQueue_.push_back(std::move(datagram));
+
+    // 读回调中的发送在handleRead最后统一发送；关注了可写事件说明内核缓冲区满了，等handleWrite
+    if (handlingRead_ || channel_->isWriting() || flushQueued_)
+    {
+        return;
+    }
+    flushQueued_ = true;
+    loop_->queueInLoop(std::bind(&UdpChannel::flushInLoop, shared_from_this()));
+}
+
+void UdpChannel::flushInLoop()
+{
+    flushQueued_ = false;
+    while (sendHead_ < sendQueue_.size())
+    {
+        int count = static_cast<int>(std::min<size_t>(batchSize_, sendQueue_.size() - sendHead_));
+        for (int i = 0; i < count; ++i)
+        {
+            PendingDatagram &datagram = sendQueue_[sendHead_ + i];
+            sendIovecs_[i].iov_base = &datagram.data[0];
+            sendIovecs_[i].iov_len = datagram.data.size();
+            struct msghdr &hdr = sendMsgs_[i].msg_hdr;
+            ::memset(&hdr, 0, sizeof hdr);
+            hdr.msg_name = &datagram.peer;
+            hdr.msg_namelen = datagram.peerLen;
+            hdr.msg_iov = &sendIovecs_[i];
+            hdr.msg_iovlen = 1;
+        }
+
+        int n = ::sendmmsg(socket_.fd(), sendMsgs_.data(), count, MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+            {
+                // 内核发送缓冲区满了，等可写事件；已经发出去的从队列中移走
+                sendQueue_.erase(sendQueue_.begin(), sendQueue_.begin() + sendHead_);
+                sendHead_ = 0;
+                if (!channel_->isWriting())
+                {
+                    channel_->enableWriting();
+                    registered_ = true;   // 没有start时也会因此加入poller
+                }
+                return;
+            }
+            // 队首的数据报发不出去(比如对端不可达)，丢掉它继续发后面的
+            LOG_ERROR("UdpChannel::flushInLoop[%s] sendmmsg errno:%d\n", name_.c_str(), errno);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            ++sendHead_;
+            continue;
+        }
+        sendCalls_.fetch_add(1, std::memory_order_relaxed);
+        datagramsSent_.fetch_add(n, std::memory_order_relaxed);
+        sendHead_ += n;
+    }
+
+    sendQueue_.clear();
+    sendHead_ = 0;
+    if (channel_->isWriting())
+    {
+        channel_->disableWriting();
+    }
+}
+
+UdpChannel::Stats UdpChannel::stats() const
+{
+    Stats stats;
+    stats.datagramsReceived = datagramsReceived_.load(std::memory_order_relaxed);
+    stats.datagramsSent = datagramsSent_.load(std::memory_order_relaxed);
+    stats.recvCalls = recvCalls_.load(std::memory_order_relaxed);
+    stats.sendCalls = sendCalls_.load(std::memory_order_relaxed);
+    stats.truncated = truncated_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
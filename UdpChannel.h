@@ -0,0 +1,121 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <sys/socket.h>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Socket.h"
+#include "Timestamp.h"
+
+class Channel;
+class EventLoop;
+class UdpChannel;
+
+using UdpChannelPtr = std::shared_ptr<UdpChannel>;
+// 收到一个数据报，data只在回调期间有效
+using DatagramCallback = std::function<void(const UdpChannelPtr &, const char *data, size_t len,
+                                            const InetAddress &peer, Timestamp)>;
+
+/**
+ * 一个绑定在某个loop上的UDP socket
+ * 可读时用recvmmsg一次收最多batchSize个数据报，逐个回调DatagramCallback
+ * 发送先放进发送队列，同一轮事件里的发送用sendmmsg一次发出去：
+ * 读回调里的回复在这批数据报处理完后统一发送，其他时候的发送在pendingFunctors中发送
+ * 内核发送缓冲区满时关注可写事件，队列超过kMaxPendingDatagrams时丢弃新的数据报(UDP本来就不可靠)
+ * */
+class UdpChannel : noncopyable, public std::enable_shared_from_this<UdpChannel>
+{
+public:
+    static const int kDefaultBatchSize = 64;
+    static const size_t kDefaultMaxDatagramSize = 2048;   // 更大的数据报会被截断，直接丢弃
+    static const size_t kMaxPendingDatagrams = 4096;
+
+    struct Stats
+    {
+        int64_t datagramsReceived;
+        int64_t datagramsSent;
+        int64_t recvCalls;        // recvmmsg调用次数，datagramsReceived / recvCalls即每次系统调用收到的数据报数
+        int64_t sendCalls;        // sendmmsg调用次数
+        int64_t truncated;        // 超过maxDatagramSize被丢弃的
+        int64_t dropped;          // 发送队列满或者发送出错丢弃的
+    };
+
+    // reusePort为true时，多个loop上的UdpChannel可以绑定同一个地址，由内核按四元组哈希分流
+    UdpChannel(EventLoop *loop,
+               const InetAddress &localAddr,
+               const std::string &name,
+               bool reusePort = true,
+               int batchSize = kDefaultBatchSize,
+               size_t maxDatagramSize = kDefaultMaxDatagramSize);
+    ~UdpChannel();   // 没有stop时要在loop线程中析构，否则LOG_FATAL
+
+    EventLoop *getLoop() const { return loop_; }
+    const std::string &name() const { return name_; }
+    const InetAddress &localAddress() const { return localAddr_; }
+
+    void setDatagramCallback(const DatagramCallback &cb) { datagramCallback_ = cb; }
+    // 小数据报在内核中占用的空间远大于数据本身，突发流量下默认的接收缓冲区很快就满了
+    void setRecvBufferSize(int bytes);
+
+    void start();   // 开始接收，线程安全
+    void stop();    // 停止接收并从poller中移除，线程安全
+
+    // 线程安全
+    void send(const InetAddress &peer, const void *data, size_t len);
+    void send(const InetAddress &peer, const std::string &message);
+
+    Stats stats() const;
+
+private:
+    struct PendingDatagram
+    {
+        sockaddr_in6 peer;   // ipv4或ipv6的地址
+        socklen_t peerLen;
+        std::string data;
+    };
+
+    void startInLoop();
+    void stopInLoop();
+    void handleRead(Timestamp receiveTime);
+    void handleWrite();
+    void sendInLoop(const InetAddress &peer, const void *data, size_t len);
+    void sendStringInLoop(const InetAddress &peer, const std::string &message);
+    void flushInLoop();   // sendmmsg发送队列中的数据报，直到队列为空或者EAGAIN
+
+    EventLoop *loop_;
+    const std::string name_;
+    const InetAddress localAddr_;
+    Socket socket_;
+    std::unique_ptr<Channel> channel_;
+    DatagramCallback datagramCallback_;
+
+    // recvmmsg的接收数组，构造时分配好，之后不再分配内存
+    const int batchSize_;
+    const size_t maxDatagramSize_;
+    std::vector<char> recvBuffer_;
+    std::vector<struct iovec> recvIovecs_;
+    std::vector<sockaddr_in6> recvAddrs_;   // 能放下ipv4和ipv6的地址
+    std::vector<struct mmsghdr> recvMsgs_;
+
+    // 以下只在loop线程中访问
+    bool registered_;              // channel_在poller中(start或者等可写事件之后、stop之前)，析构时还在就在loop中移除
+    std::vector<PendingDatagram> sendQueue_;
+    size_t sendHead_;              // sendQueue_中已经发出去的个数
+    bool handlingRead_;            // 正在处理读事件，回调中的发送等这批数据报处理完再发
+    bool flushQueued_;             // 已经向pendingFunctors加入了flushInLoop
+    std::vector<struct iovec> sendIovecs_;
+    std::vector<struct mmsghdr> sendMsgs_;
+
+    // loop线程写，其他线程读
+    std::atomic<int64_t> datagramsReceived_;
+    std::atomic<int64_t> datagramsSent_;
+    std::atomic<int64_t> recvCalls_;
+    std::atomic<int64_t> sendCalls_;
+    std::atomic<int64_t> truncated_;
+    std::atomic<int64_t> dropped_;
+};
@@ -0,0 +1,84 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+static EventLoop *CheckLoopNotNull(EventLoop *loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d mainLoop is null!\n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+UdpServer::UdpServer(EventLoop *loop,
+                     const InetAddress &listenAddr,
+                     const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , listenAddr_(listenAddr)
+    , name_(nameArg)
+    , threadPool_(new EventLoopThreadPool(loop, name_))
+    , batchSize_(UdpChannel::kDefaultBatchSize)
+    , maxDatagramSize_(UdpChannel::kDefaultMaxDatagramSize)
+    , recvBufferSize_(0)
+    , started_(0)
+{
+}
+
+UdpServer::~UdpServer()
+{
+    for (UdpChannelPtr &channel : channels_)
+    {
+        // Channel需要在所属loop中从poller里移除，functor持有UdpChannel直到移除完成
+        channel->stop();
+    }
+}
+
+void UdpServer::setThreadNum(int numThreads)
+{
+    threadPool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start()
+{
+    if (started_++ == 0)
+    {
+        threadPool_->start(threadInitCallback_);
+        std::vector<EventLoop *> loops = threadPool_->getAllLoops();
+        for (size_t i = 0; i < loops.size(); ++i)
+        {
+            char buf[64];
+            snprintf(buf, sizeof buf, "-%s#%lu", listenAddr_.toIpPort().c_str(), i);
+            UdpChannelPtr channel = std::make_shared<UdpChannel>(
+                loops[i], listenAddr_, name_ + buf, true, batchSize_, maxDatagramSize_);
+            channel->setDatagramCallback(datagramCallback_);
+            if (recvBufferSize_ > 0)
+            {
+                channel->setRecvBufferSize(recvBufferSize_);
+            }
+            channels_.push_back(channel);
+        }
+        for (UdpChannelPtr &channel : channels_)
+        {
+            channel->start();
+        }
+        LOG_INFO("UdpServer[%s] started with %lu sockets on %s\n",
+                 name_.c_str(), channels_.size(), listenAddr_.toIpPort().c_str());
+    }
+}
+
+UdpChannel::Stats UdpServer::stats() const
+{
+    UdpChannel::Stats total = UdpChannel::Stats();
+    for (const UdpChannelPtr &channel : channels_)
+    {
+        UdpChannel::Stats stats = channel->stats();
+        total.datagramsReceived += stats.datagramsReceived;
+        total.datagramsSent += stats.datagramsSent;
+        total.recvCalls += stats.recvCalls;
+        total.sendCalls += stats.sendCalls;
+        total.truncated += stats.truncated;
+        total.dropped += stats.dropped;
+    }
+    return total;
+}
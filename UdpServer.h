@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <vector>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "EventLoopThreadPool.h"
+#include "UdpChannel.h"
+
+class EventLoop;
+
+/**
+ * UDP服务器，用法和TcpServer类似
+ * 每个loop上一个UdpChannel，都用SO_REUSEPORT绑定同一个地址，内核按四元组哈希把数据报分到各个socket，
+ * 同一个对端的数据报总是落在同一个loop上，loop之间不需要任何同步
+ * 没有设置线程数时只有baseloop上的一个UdpChannel
+ * */
+class UdpServer : noncopyable
+{
+public:
+    using ThreadInitCallback = std::function<void(EventLoop *)>;
+
+    UdpServer(EventLoop *loop,
+              const InetAddress &listenAddr,
+              const std::string &nameArg);
+    ~UdpServer();
+
+    // 以下都需要在start之前设置
+    void setThreadNum(int numThreads);
+    void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    void setDatagramCallback(const DatagramCallback &cb) { datagramCallback_ = cb; }
+    void setBatchSize(int batchSize) { batchSize_ = batchSize; }   // 每次recvmmsg/sendmmsg最多处理的数据报数
+    void setMaxDatagramSize(size_t maxDatagramSize) { maxDatagramSize_ = maxDatagramSize; }
+    void setRecvBufferSize(int bytes) { recvBufferSize_ = bytes; }   // 每个socket的SO_RCVBUF，0表示使用系统默认值
+
+    void start();
+
+    // start之后不再变化
+    const std::vector<UdpChannelPtr> &channels() const { return channels_; }
+    UdpChannel::Stats stats() const;   // 所有UdpChannel的统计之和
+
+private:
+    EventLoop *loop_;
+    const InetAddress listenAddr_;
+    const std::string name_;
+    std::shared_ptr<EventLoopThreadPool> threadPool_;
+    DatagramCallback datagramCallback_;
+    ThreadInitCallback threadInitCallback_;
+    int batchSize_;
+    size_t maxDatagramSize_;
+    int recvBufferSize_;
+    std::atomic_int started_;
+    std::vector<UdpChannelPtr> channels_;
+};
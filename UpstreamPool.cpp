@@ -0,0 +1,331 @@
+#include <deque>
+#include <unordered_set>
+#include <netinet/tcp.h>
+
+#include "UpstreamPool.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+/**
+ * 一个loop上的连接池分区，所有成员只在所属loop线程中访问
+ * 连接的三种状态：connecting(TcpClient正在连接)、idle(空闲，在idle_中)、busy(被acquire走，在leased_中)
+ * 地址、配置和回调在创建时从UpstreamPool拷贝过来，UpstreamPool析构后分区还在loop中收尾也不会访问它
+ * */
+class LoopPartition : noncopyable, public std::enable_shared_from_this<LoopPartition>
+{
+public:
+    using AcquireCallback = UpstreamPool::AcquireCallback;
+
+    LoopPartition(const UpstreamPool &pool, EventLoop *loop, int index)
+        : upstreamAddr_(pool.upstreamAddr_)
+        , name_(pool.name_)
+        , options_(pool.options_)
+        , messageCallback_(pool.messageCallback_)
+        , connectionCallback_(pool.connectionCallback_)
+        , loop_(loop)
+        , index_(index)
+        , nextClientId_(0)
+        , connecting_(0)
+        , stopped_(false)
+        , healthTimer_(0)
+    {
+    }
+
+    void start()
+    {
+        healthTimer_ = loop_->runEvery(options_.healthCheckIntervalMs,
+                                       std::bind(&LoopPartition::healthCheck, shared_from_this()));
+    }
+
+    void stop()
+    {
+        stopped_ = true;
+        loop_->cancel(healthTimer_);
+        for (const AcquireCallback &cb : waiters_)
+        {
+            cb(TcpConnectionPtr());
+        }
+        waiters_.clear();
+        idle_.clear();
+        leased_.clear();   // 之后的release都不再处理
+        for (auto &item : clients_)
+        {
+            loop_->cancel(item.second.connectTimer);
+        }
+        clients_.clear();   // TcpClient析构时关闭连接
+    }
+
+    void acquire(const AcquireCallback &cb)
+    {
+        if (stopped_)
+        {
+            cb(TcpConnectionPtr());
+            return;
+        }
+        // 后进先出，最近用过的连接更可能是健康的
+        while (!idle_.empty())
+        {
+            TcpConnectionPtr conn = idle_.back().conn;
+            idle_.pop_back();
+            if (conn->connected())
+            {
+                leased_.insert(conn.get());
+                cb(conn);
+                return;
+            }
+        }
+
+        if (waiters_.size() >= options_.maxPendingPerLoop)
+        {
+            cb(TcpConnectionPtr());   // 过载，直接拒绝
+            return;
+        }
+        waiters_.push_back(cb);
+        if (total() < options_.maxConnectionsPerLoop && connecting_ < static_cast<int>(waiters_.size()))
+        {
+            newClient();
+        }
+    }
+
+    void release(const TcpConnectionPtr &conn)
+    {
+        // 重复release、不是这个分区借出的连接、借出后已经断开的连接都不处理
+        if (leased_.erase(conn.get()) == 0)
+        {
+            return;
+        }
+        if (conn->connected() && !stopped_)
+        {
+            handOut(conn);
+        }
+    }
+
+private:
+    struct IdleConnection
+    {
+        TcpConnectionPtr conn;
+        int64_t idleSinceUs;
+    };
+
+    struct Client
+    {
+        std::unique_ptr<TcpClient> client;
+        TimerId connectTimer;   // 连上之后取消
+        bool connected;
+    };
+
+    int total() const { return connecting_ + static_cast<int>(leased_.size() + idle_.size()); }
+
+    // 有等待者就直接交给等待者，不进入空闲队列
+    void handOut(const TcpConnectionPtr &conn)
+    {
+        if (!waiters_.empty())
+        {
+            AcquireCallback cb = waiters_.front();
+            waiters_.pop_front();
+            leased_.insert(conn.get());
+            cb(conn);
+            return;
+        }
+        idle_.push_back(IdleConnection{conn, Timer::nowMicros()});
+    }
+
+    // TcpClient用分区内递增的id标识，id不会复用，销毁后迟到的回调按id找不到就忽略
+    void newClient()
+    {
+        int id = nextClientId_++;
+        char buf[64];
+        snprintf(buf, sizeof buf, "-%d-%d", index_, id);
+        Client &entry = clients_[id];
+        entry.client.reset(new TcpClient(loop_, upstreamAddr_, name_ + buf));
+        entry.connected = false;
+        ++connecting_;
+
+        std::weak_ptr<LoopPartition> weakSelf(shared_from_this());
+        entry.client->setConnectionCallback(
+            [weakSelf, id](const TcpConnectionPtr &conn)
+            {
+                std::shared_ptr<LoopPartition> self = weakSelf.lock();
+                if (self)
+                {
+                    self->onConnection(id, conn);
+                }
+            });
+        entry.client->setMessageCallback(messageCallback_);
+        entry.client->connect();
+
+        // 超时还没连上就放弃，避免等待者一直等下去
+        entry.connectTimer = loop_->runAfter(options_.connectTimeoutMs,
+                                             std::bind(&LoopPartition::checkConnectTimeout, shared_from_this(), id));
+    }
+
+    void onConnection(int id, const TcpConnectionPtr &conn)
+    {
+        if (connectionCallback_)
+        {
+            connectionCallback_(conn);
+        }
+
+        auto it = clients_.find(id);
+        if (it == clients_.end())
+        {
+            return;   // 已经超时放弃或者分区已经停止
+        }
+        if (conn->connected())
+        {
+            --connecting_;
+            it->second.connected = true;
+            loop_->cancel(it->second.connectTimer);
+            if (stopped_)
+            {
+                return;
+            }
+            handOut(conn);
+        }
+        else
+        {
+            // 连接断开，从空闲队列或者借出的集合中移除，借出的连接调用方不必再release，名额在这里收回
+            // TcpClient在下一轮销毁
+            removeIdle(conn);
+            leased_.erase(conn.get());
+            loop_->queueInLoop(std::bind(&LoopPartition::destroyClient, shared_from_this(), id));
+        }
+    }
+
+    void checkConnectTimeout(int id)
+    {
+        auto it = clients_.find(id);
+        if (it == clients_.end() || it->second.connected)
+        {
+            return;
+        }
+        LOG_ERROR("UpstreamPool %s connect to %s timeout\n",
+                  name_.c_str(), upstreamAddr_.toIpPort().c_str());
+        --connecting_;
+        it->second.client->stop();
+        clients_.erase(it);
+        if (!waiters_.empty() && connecting_ < static_cast<int>(waiters_.size()))
+        {
+            AcquireCallback cb = waiters_.front();
+            waiters_.pop_front();
+            cb(TcpConnectionPtr());
+        }
+    }
+
+    void destroyClient(int id)
+    {
+        clients_.erase(id);
+        // 有连接断开，腾出了名额，给还在等待的请求补一个连接
+        if (!stopped_ && !waiters_.empty() && total() < options_.maxConnectionsPerLoop)
+        {
+            newClient();
+        }
+    }
+
+    void removeIdle(const TcpConnectionPtr &conn)
+    {
+        for (auto it = idle_.begin(); it != idle_.end(); ++it)
+        {
+            if (it->conn == conn)
+            {
+                idle_.erase(it);
+                return;
+            }
+        }
+    }
+
+    // 关闭空闲太久的连接和已经不是ESTABLISHED状态的连接
+    void healthCheck()
+    {
+        int64_t now = Timer::nowMicros();
+        int64_t maxIdleUs = static_cast<int64_t>(options_.maxIdleMs) * 1000;
+        struct tcp_info tcpi;
+        for (auto it = idle_.begin(); it != idle_.end(); )
+        {
+            const TcpConnectionPtr &conn = it->conn;
+            bool healthy = conn->connected()
+                && now - it->idleSinceUs < maxIdleUs
+                && conn->getTcpInfo(&tcpi) && tcpi.tcpi_state == TCP_ESTABLISHED;
+            if (!healthy)
+            {
+                conn->forceClose();
+                it = idle_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    const InetAddress upstreamAddr_;
+    const std::string name_;
+    const UpstreamPool::Options options_;
+    const MessageCallback messageCallback_;
+    const ConnectionCallback connectionCallback_;
+    EventLoop *loop_;
+    const int index_;
+    int nextClientId_;
+    int connecting_;
+    bool stopped_;
+    TimerId healthTimer_;
+    std::deque<IdleConnection> idle_;
+    std::unordered_set<TcpConnection *> leased_;   // 借出的连接，断开或者release时移除
+    std::deque<AcquireCallback> waiters_;
+    std::unordered_map<int, Client> clients_;
+};
+
+UpstreamPool::UpstreamPool(const InetAddress &upstreamAddr, const std::string &name, const Options &options)
+    : upstreamAddr_(upstreamAddr)
+    , name_(name)
+    , options_(options)
+{
+}
+
+UpstreamPool::~UpstreamPool()
+{
+    stop();
+}
+
+void UpstreamPool::start(const std::vector<EventLoop *> &loops)
+{
+    int index = 0;
+    for (EventLoop *loop : loops)
+    {
+        std::shared_ptr<LoopPartition> partition(new LoopPartition(*this, loop, index++));
+        partitions_[loop] = partition;
+        loop->runInLoop(std::bind(&LoopPartition::start, partition));
+    }
+}
+
+void UpstreamPool::stop()
+{
+    for (auto &item : partitions_)
+    {
+        item.first->runInLoop(std::bind(&LoopPartition::stop, item.second));
+    }
+}
+
+void UpstreamPool::acquire(EventLoop *loop, const AcquireCallback &cb)
+{
+    auto it = partitions_.find(loop);
+    if (it == partitions_.end())
+    {
+        LOG_ERROR("UpstreamPool::acquire %s - loop %p has no partition\n", name_.c_str(), loop);
+        cb(TcpConnectionPtr());
+        return;
+    }
+    // 正常情况下就在loop线程中，runInLoop直接执行
+    loop->runInLoop(std::bind(&LoopPartition::acquire, it->second, cb));
+}
+
+void UpstreamPool::release(const TcpConnectionPtr &upstream)
+{
+    auto it = partitions_.find(upstream->getLoop());
+    if (it != partitions_.end())
+    {
+        upstream->getLoop()->runInLoop(std::bind(&LoopPartition::release, it->second, upstream));
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+
+class EventLoop;
+class LoopPartition;
+
+/**
+ * 到同一个上游地址的长连接池，按EventLoop分区
+ * 每个loop有自己独立的空闲连接、等待队列和并发上限，只在本loop线程中访问，不需要加锁
+ * subloop N上处理的请求只会拿到subloop N上的上游连接，读写都不需要queueInLoop跨线程
+ *
+ * 用法：
+ *   pool.start(server.threadPool()->getAllLoops());
+ *   // 在某个连接的onMessage中(conn所属的loop线程)
+ *   pool.acquire(conn->getLoop(), [](const TcpConnectionPtr &upstream) { ... });
+ *   // 上游响应处理完后
+ *   pool.release(upstream);
+ * */
+class UpstreamPool : noncopyable
+{
+public:
+    // upstream为空表示获取失败：等待队列已满、连接超时或者连接池已停止
+    using AcquireCallback = std::function<void(const TcpConnectionPtr &upstream)>;
+
+    struct Options
+    {
+        int maxConnectionsPerLoop = 8;      // 每个loop到上游的最大连接数，即每个loop的最大并发
+        size_t maxPendingPerLoop = 1024;    // 连接数达到上限后最多排队的acquire数，超过直接失败
+        int maxIdleMs = 60 * 1000;          // 空闲超过这个时间的连接被关闭
+        int healthCheckIntervalMs = 1000;   // 空闲连接的检查周期
+        int connectTimeoutMs = 3000;        // 建立连接的超时时间
+    };
+
+    UpstreamPool(const InetAddress &upstreamAddr, const std::string &name, const Options &options);
+    ~UpstreamPool();   // 通知各分区停止，分区自己持有所需的状态，不必等它们停完
+
+    // 上游连接的回调，和TcpClient的一样，在连接所属loop中执行；要在start之前设置
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+
+    // 每个loop创建一个分区，只能调用一次，之后分区表不再修改
+    void start(const std::vector<EventLoop *> &loops);
+    void stop();
+
+    // 从loop的分区获取一个上游连接，cb在loop线程中执行，可能是立即执行
+    void acquire(EventLoop *loop, const AcquireCallback &cb);
+    // 归还连接，在连接所属的loop中执行；借出后已经断开的连接可以不归还，重复归还的忽略
+    void release(const TcpConnectionPtr &upstream);
+
+    const InetAddress &upstreamAddress() const { return upstreamAddr_; }
+    const std::string &name() const { return name_; }
+
+private:
+    friend class LoopPartition;
+
+    const InetAddress upstreamAddr_;
+    const std::string name_;
+    const Options options_;
+    MessageCallback messageCallback_;
+    ConnectionCallback connectionCallback_;
+    std::unordered_map<EventLoop *, std::shared_ptr<LoopPartition>> partitions_;
+};
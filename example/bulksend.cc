@@ -0,0 +1,91 @@
+#include <string>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "../TcpServer.h"
+#include "../Logger.h"
+
+// 大块数据发送，对比拷贝和MSG_ZEROCOPY两种方式的cpu开销
+// 用法: bulksend [port] [MB per connection] [zerocopy|copy] [chunk KB]
+// 客户端连上后服务端发送指定大小的数据然后关闭，比如: nc host 8005 > /dev/null
+// 回环地址上内核总是会拷贝，零拷贝会自动关闭，需要在真实网卡上测试
+
+static int64_t g_totalBytes = 1024LL * 1024 * 1024;
+static size_t g_chunkBytes = 1024 * 1024;
+static bool g_zeroCopy = true;
+
+struct SendState
+{
+    int64_t remaining;
+    struct timeval startCpu;
+};
+
+static struct timeval cpuTime()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    struct timeval tv;
+    timeradd(&usage.ru_utime, &usage.ru_stime, &tv);
+    return tv;
+}
+
+static void sendMore(const TcpConnectionPtr &conn)
+{
+    std::shared_ptr<SendState> state = std::static_pointer_cast<SendState>(conn->getContext());
+    if (!state)
+    {
+        return;
+    }
+    if (state->remaining <= 0)
+    {
+        struct timeval now = cpuTime();
+        struct timeval used;
+        timersub(&now, &state->startCpu, &used);
+        LOG_INFO("%s sent %lld MB, cpu %ld.%06lds, zerocopy sends %lld, copied %lld\n",
+                 conn->name().c_str(), (long long)(g_totalBytes >> 20), (long)used.tv_sec, (long)used.tv_usec,
+                 (long long)conn->zeroCopySends(), (long long)conn->zeroCopyCopied());
+        conn->setContext(std::shared_ptr<void>());
+        conn->shutdown();
+        return;
+    }
+    size_t len = static_cast<size_t>(std::min<int64_t>(state->remaining, g_chunkBytes));
+    state->remaining -= len;
+    std::string chunk(len, 'z');
+    conn->send(std::move(chunk));   // 大于阈值时连接接管chunk，不再拷贝
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        if (g_zeroCopy && !conn->enableZeroCopy())
+        {
+            LOG_ERROR("%s SO_ZEROCOPY not supported, fall back to copy\n", conn->name().c_str());
+        }
+        std::shared_ptr<SendState> state = std::make_shared<SendState>();
+        state->remaining = g_totalBytes;
+        state->startCpu = cpuTime();
+        conn->setContext(state);
+        sendMore(conn);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 8005;
+    g_totalBytes = (argc > 2 ? atoll(argv[2]) : 1024) * 1024 * 1024;
+    g_zeroCopy = !(argc > 3 && strcmp(argv[3], "copy") == 0);
+    g_chunkBytes = (argc > 4 ? atoi(argv[4]) : 1024) * 1024;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port, "0.0.0.0"), "BulkSend");
+    server.setConnectionCallback(onConnection);
+    server.setWriteCompleteCallback(sendMore);
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * 短连接压测，衡量服务器每秒能建立并销毁多少个连接
+ * 每个线程循环: 建立连接 -> 发送64字节 -> 收到回显 -> 关闭，统计每秒完成的连接数
+ * 关闭时设置SO_LINGER为0直接发RST，避免客户端积累TIME_WAIT耗尽本地端口
+ *
+ * 用法: churn [port] [threads] [seconds]   (配合testserver，端口8002)
+ *   testserver 8002 &
+ *   churn 8002 8 10
+ **/
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+static std::atomic<bool> g_running(true);
+static std::atomic<long> g_connections(0);
+static std::atomic<long> g_failures(0);
+
+static bool oneConnection(const sockaddr_in &addr)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = false;
+    if (::connect(fd, (const sockaddr *)&addr, sizeof addr) == 0)
+    {
+        char buf[64];
+        ::memset(buf, 'x', sizeof buf);
+        if (::write(fd, buf, sizeof buf) == sizeof buf)
+        {
+            size_t received = 0;
+            while (received < sizeof buf)
+            {
+                ssize_t n = ::read(fd, buf + received, sizeof buf - received);
+                if (n <= 0)
+                {
+                    break;
+                }
+                received += n;
+            }
+            ok = received == sizeof buf;
+        }
+    }
+    linger lin = {1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof lin);
+    ::close(fd);
+    return ok;
+}
+
+static void worker(const sockaddr_in &addr)
+{
+    while (g_running)
+    {
+        if (oneConnection(addr))
+        {
+            ++g_connections;
+        }
+        else
+        {
+            ++g_failures;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 8002;
+    int threads = argc > 2 ? atoi(argv[2]) : 8;
+    int seconds = argc > 3 ? atoi(argv[3]) : 10;
+
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(worker, addr);
+    }
+
+    long last = 0;
+    for (int i = 0; i < seconds; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        long now = g_connections;
+        printf("%ld conn/s\n", now - last);
+        last = now;
+    }
+    g_running = false;
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("churn %d: %d threads, %ld connections (%ld failed) in %.2fs, %.0f conn/s\n",
+           port, threads, g_connections.load(), g_failures.load(), elapsed, g_connections / elapsed);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * 用协程写的多步骤协议，需要C++20编译并链接mymuduo_coro
+ * 每行一个命令，以\r\n结尾：
+ *   data <n>   之后跟n个字节的数据，原样返回这n个字节
+ *   sleep <ms> 等待ms毫秒后返回"ok\r\n"，期间不影响这个loop上的其他连接
+ *   其他       整行原样返回
+ *
+ * 用法: coecho [port] [threads]
+ *   printf 'data 5\r\nhellosleep 100\r\nbye\r\n' | nc 127.0.0.1 8003
+ **/
+#include <string>
+#include <stdlib.h>
+
+#include "../TcpServer.h"
+#include "../Coroutine.h"
+#include "../Logger.h"
+
+static CoTask session(TcpConnectionPtr conn)
+{
+    CoConnection stream(conn);
+    while (std::optional<std::string> line = co_await stream.readUntil("\r\n"))
+    {
+        std::string reply;
+        if (line->compare(0, 5, "data ") == 0)
+        {
+            std::optional<std::string> body = co_await stream.read(static_cast<size_t>(atoi(line->c_str() + 5)));
+            if (!body)
+            {
+                break;
+            }
+            reply = std::move(*body);
+        }
+        else if (line->compare(0, 6, "sleep ") == 0)
+        {
+            co_await conn->getLoop()->sleep(atoi(line->c_str() + 6));
+            reply = "ok\r\n";
+        }
+        else
+        {
+            reply = *line + "\r\n";
+        }
+        if (!co_await stream.write(reply))
+        {
+            break;
+        }
+    }
+    LOG_INFO("session %s done\n", conn->name().c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 8003;
+    int threads = argc > 2 ? atoi(argv[2]) : 3;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(static_cast<uint16_t>(port)), "CoEcho");
+    server.setThreadNum(threads);
+    server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            session(conn);   // 在连接所属的loop中启动，之后由CoConnection接管这个连接的回调
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr &, Buffer *, Timestamp) {});
+    server.start();
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * Channel事件分发的开销
+ * 1. 不经过epoll，直接设置revents后调用handleEvent
+ *      function: 读回调是std::bind绑定的成员函数(std::function)
+ *      handler:  Channel指向一个EventHandler，虚函数分发
+ *      tied:     handler，另外用Channel::tie绑定一个shared_ptr，每个事件多一次weak_ptr::lock
+ * 2. epoll: N个eventfd计数不清零，一直可读，每轮loop分发N个就绪的Channel，
+ *    统计EventLoop::loop的整条路径(epoll_wait、Poller填充活跃Channel、handleEvent)
+ * 每项输出每个事件的平均纳秒数，内核允许时附带perf计数器(周期、指令、L1D读缺失、cache缺失)
+ *
+ * 用法: dispatchbench [channels] [rounds]
+ **/
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "EventLoop.h"
+#include "Channel.h"
+#include "EventHandler.h"
+
+// 当前线程的一组硬件计数器，打不开(容器、虚拟机、perf_event_paranoid)时只输出时间
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    }
+    ~PerfCounters()
+    {
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    void start()
+    {
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    void stopAndPrint(double events)
+    {
+        static const char *kNames[] = {"cycles", "instructions", "L1D-read-misses", "cache-misses"};
+        bool any = false;
+        for (size_t i = 0; i < fds_.size(); ++i)
+        {
+            if (fds_[i] < 0)
+            {
+                continue;
+            }
+            ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            long long count = 0;
+            if (::read(fds_[i], &count, sizeof count) == sizeof count)
+            {
+                printf("      %s/event: %.3f\n", kNames[i], count / events);
+                any = true;
+            }
+        }
+        if (!any)
+        {
+            printf("      (perf counters unavailable)\n");
+        }
+    }
+
+private:
+    void open(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        ::memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;   // 只统计用户态，epoll_wait内核部分两种布局一样
+        attr.exclude_hv = 1;
+        fds_.push_back(static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)));
+    }
+
+    std::vector<int> fds_;
+};
+
+class Counter final : public EventHandler
+{
+public:
+    Counter() : reads_(0), loop_(nullptr), target_(0) {}
+    void onRead(Timestamp) { ++reads_; }
+    void handleRead(Timestamp) override
+    {
+        // 不读eventfd，保持可读
+        if (++reads_ == target_)
+        {
+            loop_->quit();
+        }
+    }
+    long reads() const { return reads_; }
+    void quitAt(EventLoop *loop, long target) { loop_ = loop; target_ = target; }
+
+private:
+    long reads_;
+    EventLoop *loop_;
+    long target_;
+};
+
+static void run(std::vector<std::unique_ptr<Channel>> &channels, int rounds, PerfCounters *perf)
+{
+    Timestamp now = Timestamp::now();
+    if (perf != nullptr)
+    {
+        perf->start();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (auto &channel : channels)
+        {
+            channel->set_revents(EPOLLIN);
+            channel->handleEvent(now);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (perf != nullptr)   // 预热时不输出
+    {
+        double events = static_cast<double>(channels.size()) * rounds;
+        printf("  %.2f ns/event\n", ns / events);
+        perf->stopAndPrint(events);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 10000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+
+    EventLoop loop;
+    PerfCounters perf;
+    printf("dispatchbench: %d channels x %d rounds, sizeof(Channel)=%zu\n", n, rounds, sizeof(Channel));
+
+    {
+        std::vector<Counter> counters(n);
+        std::vector<std::unique_ptr<Channel>> functionChannels;
+        std::vector<std::unique_ptr<Channel>> handlerChannels;
+        std::vector<std::unique_ptr<Channel>> tiedChannels;
+        std::vector<std::shared_ptr<int>> owners;
+        for (int i = 0; i < n; ++i)
+        {
+            // fd只是一个标识，这些Channel不会注册到poller
+            functionChannels.emplace_back(new Channel(&loop, 100000 + i));
+            functionChannels.back()->setReadCallback(
+                std::bind(&Counter::onRead, &counters[i], std::placeholders::_1));
+            handlerChannels.emplace_back(new Channel(&loop, 100000 + i));
+            handlerChannels.back()->setEventHandler(&counters[i]);
+            owners.push_back(std::make_shared<int>(i));
+            tiedChannels.emplace_back(new Channel(&loop, 100000 + i));
+            tiedChannels.back()->setEventHandler(&counters[i]);
+            tiedChannels.back()->tie(owners.back());
+        }
+        run(functionChannels, 10, nullptr);   // 预热
+        run(handlerChannels, 10, nullptr);
+        run(tiedChannels, 10, nullptr);
+        printf("function:\n");
+        run(functionChannels, rounds, &perf);
+        printf("handler:\n");
+        run(handlerChannels, rounds, &perf);
+        printf("tied:\n");
+        run(tiedChannels, rounds, &perf);
+    }
+
+    {
+        // 所有Channel共用一个计数器，分发够n*rounds次后退出loop
+        Counter counter;
+        std::vector<std::unique_ptr<Channel>> channels;
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (fd < 0)
+            {
+                perror("eventfd (ulimit -n?)");
+                return 1;
+            }
+            channels.emplace_back(new Channel(&loop, fd));
+            channels.back()->setEventHandler(&counter);
+            channels.back()->enableReading();
+        }
+        counter.quitAt(&loop, static_cast<long>(n) * 20);   // 预热，让Poller的事件数组扩容到n
+        loop.loop();
+
+        Counter timed;
+        timed.quitAt(&loop, static_cast<long>(n) * rounds);
+        for (auto &channel : channels)
+        {
+            channel->setEventHandler(&timed);
+        }
+        printf("epoll (%d ready fds per poll):\n", n);
+        perf.start();
+        auto start = std::chrono::steady_clock::now();
+        loop.loop();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        double events = static_cast<double>(n) * rounds;
+        printf("  %.2f ns/event\n", ns / events);
+        perf.stopAndPrint(events);
+
+        for (auto &channel : channels)
+        {
+            channel->disableAll();
+            channel->remove();
+            ::close(channel->fd());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <string>
+#include <functional>
+#include <stdlib.h>
+
+#include "../HttpServer.h"
+#include "../Logger.h"
+
+static HttpServer *g_server = nullptr;
+
+// 每100ms发一个chunk，发完kTicks个之后结束响应，连接上的后续请求随后继续处理
+static const int kTicks = 5;
+
+static void tick(const TcpConnectionPtr &conn, int n)
+{
+    if (!conn->connected())
+    {
+        return;
+    }
+    if (n == kTicks)
+    {
+        g_server->finishChunked(conn);
+        return;
+    }
+    std::string data = "tick " + std::to_string(n) + "\n";
+    HttpServer::sendChunk(conn, data.data(), data.size());
+    conn->getLoop()->runAfter(100, std::bind(tick, conn, n + 1));
+}
+
+// 用法: httpserver [port] [threads]
+// GET /hello 返回固定内容，GET /stream 返回chunked响应，GET /ticks 流式返回kTicks个chunk，其余返回404
+void onRequest(const TcpConnectionPtr &conn, const HttpRequest &req, HttpResponse *resp)
+{
+    if (req.path() == "/hello")
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        resp->setBody("hello, world!\n");
+    }
+    else if (req.path() == "/stream")
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        resp->setChunked(true);
+        resp->addChunk("hello, ");
+        resp->addChunk("chunked world!\n");
+    }
+    else if (req.path() == "/ticks")
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        resp->setStreaming(true);
+        tick(conn, 0);
+    }
+    else
+    {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setStatusMessage("Not Found");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 8000;
+    int threads = argc > 2 ? atoi(argv[2]) : 3;
+
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(port), "HttpServer");
+    g_server = &server;
+    server.setHttpCallback(onRequest);
+    server.setThreadNum(threads);
+    server.start();
+    loop.loop();
+    return 0;
+}
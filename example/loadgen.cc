@@ -0,0 +1,192 @@
+/**
+ * 本地压测工具，对比echo服务器和http服务器每秒处理的请求数
+ * 每个连接一个线程，阻塞socket，每次发送depth个请求(流水线)，全部收到响应后再发送下一批
+ *
+ * 用法: loadgen <echo|http> [port] [connections] [seconds] [depth]
+ *   echo: 每个请求是64字节的数据，收到同样长度的回显算一次响应  (配合testserver，端口8002)
+ *   http: 每个请求是 GET /hello，按Content-Length收完一个响应 (配合httpserver，端口8000)
+ *   port以'/'开头时连接unix域socket的路径，以'@'开头时连接抽象命名空间，用来对比回环tcp和unix域socket:
+ *     testserver 8002 & testserver @echo &
+ *     loadgen echo 8002 16 10     loadgen echo @echo 16 10
+ **/
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+static std::atomic<bool> g_running(true);
+static std::atomic<long> g_requests(0);
+
+static const char kHttpRequest[] = "GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+static int connectUnix(const std::string &path)
+{
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    // '@'开头表示抽象命名空间，sun_path[0]为'\0'
+    bool abstract = path[0] == '@';
+    std::string name = abstract ? path.substr(1) : path;
+    size_t offset = abstract ? 1 : 0;
+    ::memcpy(addr.sun_path + offset, name.data(), std::min(name.size(), sizeof(addr.sun_path) - 1 - offset));
+    socklen_t len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + offset + name.size() + (abstract ? 0 : 1));
+    if (::connect(fd, (sockaddr *)&addr, len) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+static int connectTo(const std::string &target)
+{
+    if (target[0] == '/' || target[0] == '@')
+    {
+        return connectUnix(target);
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(atoi(target.c_str())));
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(fd, (sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+static bool writeAll(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 从pending中取出一个完整的http响应，返回是否成功
+static bool takeHttpResponse(std::string &pending)
+{
+    size_t headerEnd = pending.find("\r\n\r\n");
+    if (headerEnd == std::string::npos)
+    {
+        return false;
+    }
+    size_t length = 0;
+    size_t pos = pending.find("Content-Length: ");
+    if (pos != std::string::npos && pos < headerEnd)
+    {
+        length = strtoul(pending.c_str() + pos + 16, nullptr, 10);
+    }
+    size_t total = headerEnd + 4 + length;
+    if (pending.size() < total)
+    {
+        return false;
+    }
+    pending.erase(0, total);
+    return true;
+}
+
+static void client(bool http, const std::string &target, int depth)
+{
+    int fd = connectTo(target);
+    std::string request;
+    const size_t echoSize = 64;
+    for (int i = 0; i < depth; ++i)
+    {
+        request += http ? std::string(kHttpRequest) : std::string(echoSize, 'x');
+    }
+
+    std::string pending;
+    char buf[65536];
+    while (g_running)
+    {
+        if (!writeAll(fd, request.data(), request.size()))
+        {
+            break;
+        }
+        int got = 0;
+        while (got < depth)
+        {
+            ssize_t n = ::read(fd, buf, sizeof buf);
+            if (n <= 0)
+            {
+                ::close(fd);
+                return;
+            }
+            pending.append(buf, n);
+            if (http)
+            {
+                while (got < depth && takeHttpResponse(pending))
+                {
+                    ++got;
+                }
+            }
+            else
+            {
+                int responses = static_cast<int>(pending.size() / echoSize);
+                got += responses;
+                pending.erase(0, responses * echoSize);
+            }
+        }
+        g_requests += depth;
+    }
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <echo|http> [port] [connections] [seconds] [depth]\n", argv[0]);
+        return 0;
+    }
+    bool http = strcmp(argv[1], "http") == 0;
+    std::string target = argc > 2 ? argv[2] : (http ? "8000" : "8002");
+    int connections = argc > 3 ? atoi(argv[3]) : 16;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    int depth = argc > 5 ? atoi(argv[5]) : 1;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < connections; ++i)
+    {
+        threads.emplace_back(client, http, target, depth);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    g_running = false;
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%s %s: %d connections, depth %d, %ld requests in %.2fs, %.0f req/s\n",
+           http ? "http" : "echo", target.c_str(), connections, depth, g_requests.load(), elapsed, g_requests / elapsed);
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * 耗CPU的请求在loop中直接处理和交给ComputePool处理的对比
+ * 服务器只有一个subloop，每行一个请求：
+ *   "heavy\n" 空转约5ms模拟一次JSON转换，回复"done\n"
+ *   "ping\n"  直接回复"pong\n"
+ * 若干个客户端线程不停地发heavy，另一个线程每隔1ms发一次ping，统计ping的延迟和heavy的吞吐
+ * 计算池满时heavy直接回复"busy\n"
+ *
+ * 用法: offload [inline|pool] [heavyClients] [computeThreads] [seconds]
+ **/
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../TcpServer.h"
+#include "../ComputePool.h"
+#include "../Logger.h"
+
+static const uint16_t kPort = 8004;
+static std::atomic<bool> g_running(true);
+static std::atomic<long> g_heavyDone(0);
+static std::atomic<long> g_heavyBusy(0);
+
+static std::string burn(int ms)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    unsigned long x = 0;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        x = x * 6364136223846793005UL + 1;
+    }
+    return x == 42 ? "done?\n" : "done\n";
+}
+
+static void onMessage(ComputePool *pool, const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    while (const char *eol = buf->findEOL())
+    {
+        std::string request(buf->peek(), eol);
+        buf->retrieveUntil(eol + 1);
+        if (request == "ping")
+        {
+            conn->send("pong\n");
+        }
+        else if (pool == nullptr)
+        {
+            conn->send(burn(5));
+        }
+        else if (!pool->submit(conn, [] { return burn(5); },
+                               [](const TcpConnectionPtr &c, std::string result) { c->send(result); }))
+        {
+            conn->send("busy\n");
+        }
+    }
+}
+
+static int connectServer()
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (::connect(fd, (const sockaddr *)&addr, sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    return fd;
+}
+
+// 发一行，读一行回复
+static bool request(int fd, const char *line, char *reply, size_t size)
+{
+    if (::write(fd, line, strlen(line)) < 0)
+    {
+        return false;
+    }
+    size_t n = 0;
+    while (n < size - 1)
+    {
+        ssize_t r = ::read(fd, reply + n, 1);
+        if (r <= 0)
+        {
+            return false;
+        }
+        if (reply[n++] == '\n')
+        {
+            break;
+        }
+    }
+    reply[n] = '\0';
+    return true;
+}
+
+static void heavyClient()
+{
+    int fd = connectServer();
+    char reply[32];
+    while (g_running && request(fd, "heavy\n", reply, sizeof reply))
+    {
+        if (strcmp(reply, "busy\n") == 0)
+        {
+            ++g_heavyBusy;
+            ::usleep(1000);
+        }
+        else
+        {
+            ++g_heavyDone;
+        }
+    }
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode = argc > 1 ? argv[1] : "pool";
+    int heavyClients = argc > 2 ? atoi(argv[2]) : 4;
+    int computeThreads = argc > 3 ? atoi(argv[3]) : 4;
+    int seconds = argc > 4 ? atoi(argv[4]) : 5;
+
+    ComputePool pool("compute", computeThreads, 256);
+    ComputePool *usePool = mode == "pool" ? &pool : nullptr;
+    if (usePool != nullptr)
+    {
+        pool.start();
+    }
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "Offload");
+    server.setThreadNum(1);
+    server.setConnectionCallback([](const TcpConnectionPtr &) {});
+    server.setMessageCallback(std::bind(onMessage, usePool,
+                                        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    server.start();
+
+    // 客户端在另一个线程中跑，结束后退出loop
+    std::vector<double> latencies;
+    std::thread driver([&] {
+        std::vector<std::thread> clients;
+        for (int i = 0; i < heavyClients; ++i)
+        {
+            clients.emplace_back(heavyClient);
+        }
+        int fd = connectServer();
+        char reply[32];
+        auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (!request(fd, "ping\n", reply, sizeof reply))
+            {
+                break;
+            }
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            ::usleep(1000);
+        }
+        ::close(fd);
+        g_running = false;
+        for (std::thread &t : clients)
+        {
+            t.join();
+        }
+        loop.quit();
+    });
+    loop.loop();
+    driver.join();
+    pool.stop();   // 在subloop退出之前，剩下的结果还能送回loop
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t n = latencies.size();
+    if (n > 0)
+    {
+        printf("offload %s: ping p50 %.0fus p99 %.0fus max %.0fus (%zu pings), heavy %.0f/s, busy %ld\n",
+               mode.c_str(), latencies[n / 2], latencies[n * 99 / 100], latencies[n - 1], n,
+               g_heavyDone / static_cast<double>(seconds), g_heavyBusy.load());
+    }
+    if (usePool != nullptr)
+    {
+        printf("  compute pool: %lld stolen, %lld rejected\n",
+               static_cast<long long>(pool.stolen()), static_cast<long long>(pool.rejected()));
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <string>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../TcpServer.h"
+#include "../TcpClient.h"
+#include "../TcpRelay.h"
+#include "../Logger.h"
+
+// 四层代理，把每个连接转发到本机的后端端口
+// 用法: tcprelay [listenPort] [backendPort] [threads] [splice|buffer]
+// 配合testserver(端口8002)和loadgen对比splice和Buffer两种转发方式
+
+static uint16_t g_backendPort = 8002;
+static bool g_splice = true;
+
+void onUpstreamConnection(const std::weak_ptr<TcpConnection> &weakDownstream, const TcpConnectionPtr &upstream)
+{
+    TcpConnectionPtr downstream = weakDownstream.lock();
+    if (!upstream->connected())
+    {
+        if (downstream)
+        {
+            downstream->shutdown();
+        }
+        return;
+    }
+    if (!downstream || !downstream->connected())
+    {
+        upstream->shutdown();
+        return;
+    }
+    std::shared_ptr<TcpRelay> relay = std::make_shared<TcpRelay>(downstream, upstream);
+    relay->setSplice(g_splice);
+    relay->start();
+    downstream->startRead();
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        // 后端连上之前先不读客户端的数据
+        conn->stopRead();
+        // 后端连接和客户端连接在同一个loop上，才能走splice
+        std::shared_ptr<TcpClient> client = std::make_shared<TcpClient>(
+            conn->getLoop(), InetAddress(g_backendPort), "upstream-" + conn->name());
+        client->setConnectionCallback(
+            std::bind(&onUpstreamConnection, std::weak_ptr<TcpConnection>(conn), std::placeholders::_1));
+        conn->setContext(client);
+        client->connect();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 8003;
+    g_backendPort = argc > 2 ? static_cast<uint16_t>(atoi(argv[2])) : 8002;
+    int threads = argc > 3 ? atoi(argv[3]) : 3;
+    g_splice = !(argc > 4 && strcmp(argv[4], "buffer") == 0);
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "TcpRelay");
+    server.setConnectionCallback(onConnection);
+    server.setThreadNum(threads);
+    server.start();
+    loop.loop();
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <string>
+#include <stdlib.h>
 
 #include "../TcpServer.h"
 #include "../Logger.h"
@@ -6,8 +7,9 @@
 class EchoServer
 {
 public:
-    EchoServer(EventLoop *loop, const InetAddress &addr, const std::string &name)
-        : server_(loop, addr, name)
+    EchoServer(EventLoop *loop, const InetAddress &addr, const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort)
+        : server_(loop, addr, name, option)
         , loop_(loop)
     {
         // 注册回调函数
@@ -20,6 +22,7 @@ public:
         // 设置合适的subloop线程数量
         server_.setThreadNum(3);    // 这三个是子reactor的eventloop
     }
+    TcpServer &server() { return server_; }
     void start()
     {
         server_.start();
@@ -51,10 +54,38 @@ private:
     TcpServer server_;
 };
 
-int main() {
+// 用法: testserver [port] [spinUs] [main|reuseport|exclusive]   port以'/'开头时监听unix域socket的路径，以'@'开头时监听抽象命名空间
+//   spinUs不为0时subloop忙轮询spinUs微秒后才阻塞，并给连接设置同样时长的SO_BUSY_POLL
+//   最后一个参数选择accept的方式：main由baseloop accept后轮询分给subloop(默认)，
+//   reuseport每个subloop一个SO_REUSEPORT的listen socket，exclusive每个subloop以EPOLLEXCLUSIVE监听同一个listen socket
+int main(int argc, char *argv[]) {
     EventLoop loop;  // 主reactor中的eventloop
-    InetAddress addr(8002);
-    EchoServer server(&loop, addr, "EchoServer");
+    std::string listen = argc > 1 ? argv[1] : "8002";
+    InetAddress addr(static_cast<uint16_t>(atoi(listen.c_str())));
+    if (listen[0] == '/' || listen[0] == '@')
+    {
+        addr = InetAddress::unixDomain(listen[0] == '@' ? listen.substr(1) : listen, listen[0] == '@');
+        if (!addr.isValid())
+        {
+            return 1;   // 路径太长，unixDomain已经记录了错误
+        }
+    }
+    std::string accept = argc > 3 ? argv[3] : "main";
+    TcpServer::Option option = TcpServer::kNoReusePort;
+    if (accept == "reuseport")
+    {
+        option = TcpServer::kReusePortPerLoop;
+    }
+    else if (accept == "exclusive")
+    {
+        option = TcpServer::kExclusiveAccept;
+    }
+    EchoServer server(&loop, addr, "EchoServer", option);
+    int spinUs = argc > 2 ? atoi(argv[2]) : 0;
+    if (spinUs > 0)
+    {
+        server.server().setBusyPoll(spinUs, spinUs);
+    }
     server.start();
     loop.loop();
     return 0;
@@ -0,0 +1,53 @@
+#include <string>
+#include <stdlib.h>
+
+#include "../UdpServer.h"
+#include "../EventLoop.h"
+#include "../Logger.h"
+
+// UDP回显服务器，每秒打印一次每次系统调用平均收发的数据报数
+// 用法: udpserver [port] [threads] [batch]
+
+UdpServer *g_server = nullptr;
+
+void onDatagram(const UdpChannelPtr &channel, const char *data, size_t len, const InetAddress &peer, Timestamp)
+{
+    channel->send(peer, data, len);   // 同一批数据报的回复合并成一次sendmmsg
+}
+
+void printStats()
+{
+    static UdpChannel::Stats last = UdpChannel::Stats();
+    UdpChannel::Stats now = g_server->stats();
+    int64_t recv = now.datagramsReceived - last.datagramsReceived;
+    int64_t recvCalls = now.recvCalls - last.recvCalls;
+    int64_t sent = now.datagramsSent - last.datagramsSent;
+    int64_t sendCalls = now.sendCalls - last.sendCalls;
+    if (recv > 0)
+    {
+        LOG_INFO("recv %lld/s (%.1f per call), sent %lld/s (%.1f per call), truncated %lld, dropped %lld\n",
+                 (long long)recv, recvCalls > 0 ? (double)recv / recvCalls : 0.0,
+                 (long long)sent, sendCalls > 0 ? (double)sent / sendCalls : 0.0,
+                 (long long)now.truncated, (long long)now.dropped);
+    }
+    last = now;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 8006;
+    int threads = argc > 2 ? atoi(argv[2]) : 3;
+    int batch = argc > 3 ? atoi(argv[3]) : UdpChannel::kDefaultBatchSize;
+
+    EventLoop loop;
+    UdpServer server(&loop, InetAddress(port, "0.0.0.0"), "UdpServer");
+    g_server = &server;
+    server.setDatagramCallback(onDatagram);
+    server.setThreadNum(threads);
+    server.setBatchSize(batch);
+    server.setRecvBufferSize(4 * 1024 * 1024);
+    server.start();
+    loop.runEvery(1000, printStats);
+    loop.loop();
+    return 0;
+}